@@ -0,0 +1,31 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    app.h
+  * @brief   This file contains all the function prototypes for
+  *          the app.c file
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __APP_H__
+#define __APP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+#define LOOP_MAX_SLEEP_MS       1000    // upper bound on a sleep without deadlines
+
+void app_init(void);
+void app_pass(uint32_t current_time, uint8_t rx, uint8_t button, uint8_t timer);
+uint32_t loop_next_deadline(uint32_t current_time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __APP_H__ */
@@ -0,0 +1,177 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    comm.h
+  * @brief   This file contains all the function prototypes for
+  *          the comm.c file
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __COMM_H__
+#define __COMM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+#define CMD_LINE_SIZE           40      // fits CMD:R:65535:STORM_UPDATE:-10,-10
+#define RX_BUFFER_SIZE          32
+#define CMD_QUEUE_SIZE          8       // power of two, one slot is always being filled
+#define TX_RING_SIZE            2048    // power of two
+#define TX_EVENT_RESERVE        256     // ring space only game events may use
+#define TX_LINE_SIZE            128
+#define TICK_MAX_EVENTS         4       // keeps an ASCII TICK line inside TX_LINE_SIZE
+#define FRAME_MAX_SIZE          (TX_LINE_SIZE + 8)  // message + CRC + COBS overhead + delimiter
+
+// Binary protocol message types, shared with Web/js/com-interface.js.
+// Device -> browser
+#define MSG_TIME                0x01    // u8 seconds
+#define MSG_SHIP                0x02    // u8 type, u16 x, u16 y
+#define MSG_HIT                 0x03    // u8 type, u16 x, u16 y
+#define MSG_MISS                0x04    // u16 x, u16 y
+#define MSG_STORM               0x05    // i16 x, i16 y
+#define MSG_TICK                0x06    // u8 time, i16 storm x, i16 storm y, u8 count,
+                                        // count * (u8 msg, u8 type, u16 x, u16 y)
+#define MSG_STORM_PARAM         0x07    // u8 amp x, u8 amp y, u16 period x, u16 period y,
+                                        // u16 phase y (mrad), u32 tick
+#define MSG_STORM_SYNC          0x08    // u32 tick
+#define MSG_REL                 0x09    // u16 seq, then a SHIP/HIT/MISS message
+#define MSG_ACK                 0x0A    // u16 last command seq received in order
+#define MSG_TEXT                0x7F    // ASCII line without CR/LF
+// With CMD:TS:1 every TIME/SHIP/HIT/MISS/STORM/TICK message ends in a u32 tick
+// Browser -> device
+#define MSG_CMD_START           0x81
+#define MSG_CMD_PAUSE           0x82
+#define MSG_CMD_RESET           0x83
+#define MSG_CMD_SHOT            0x84    // u16 x, u16 y
+#define MSG_CMD_STORM_UPDATE    0x85    // i8 dx, i8 dy
+#define MSG_CMD_PROTO           0x86    // u8 mode
+#define MSG_CMD_REL             0x87    // u16 seq, then a command message
+#define MSG_CMD_ACK             0x88    // u16 last event seq received in order
+
+// Reliable channel (CMD:REL): sequenced game events kept until acknowledged
+#define REL_WINDOW              16      // must be a power of 2
+#define REL_RTO_MS              250
+
+// Runtime baud rate switching (CMD:BAUD)
+#define UART_DEFAULT_BAUD       115200
+#define BAUD_PROBE_TIMEOUT_MS   1500
+
+typedef struct {
+    uint8_t len;
+    uint8_t is_frame;   // COBS frame rather than a text line
+    char text[CMD_LINE_SIZE];
+} CmdSlot;
+
+// Transmit priority classes. Telemetry may not eat into TX_EVENT_RESERVE,
+// so periodic STORM samples are dropped long before a RESULT/SHIP/TIME line.
+typedef enum {
+    TX_CLASS_EVENT = 0,
+    TX_CLASS_TELEMETRY,
+    TX_CLASS_COUNT
+} TxClass;
+
+typedef enum {
+    PROTO_ASCII = 0,
+    PROTO_BINARY
+} ProtoMode;
+
+typedef enum {
+    EV_TIME = 0,
+    EV_SHIP,
+    EV_HIT,
+    EV_MISS,
+    EV_STORM
+} EventKind;
+
+// One outgoing game event, encoded by send_event() for the active protocol
+typedef struct {
+    uint8_t kind;
+    uint8_t type;       // ship type, or seconds left for EV_TIME
+    int16_t x;
+    int16_t y;
+    uint32_t tick;      // HAL_GetTick() when the event happened
+} GameEvent;
+
+// Events of one main-loop pass when telemetry aggregation is on
+typedef struct {
+    uint8_t pending;
+    uint8_t count;
+    int16_t storm_x;    // last storm sample, repeated in every frame
+    int16_t storm_y;
+    uint32_t tick;      // time of the latest event in the frame
+    GameEvent events[TICK_MAX_EVENTS];
+} TickFrame;
+
+// Unacknowledged reliable event, slot index is seq & (REL_WINDOW - 1)
+typedef struct {
+    uint32_t sent_at;
+    GameEvent ev;
+} RelEntry;
+
+extern volatile ProtoMode proto_mode;
+extern uint8_t ts_enabled;
+extern volatile uint8_t logging_enabled;
+extern uint32_t rx_crc_error_count;
+extern RelEntry rel_window[REL_WINDOW];
+extern uint16_t rel_tx_base;
+extern uint16_t rel_tx_next;
+extern uint8_t rel_enabled;
+extern uint8_t rel_ack_pending;
+extern uint8_t baud_probing;
+extern uint32_t baud_probe_deadline;
+
+static inline void put_le16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static inline void put_le32(uint8_t *p, uint32_t v) {
+    put_le16(p, v & 0xFFFF);
+    put_le16(p + 2, v >> 16);
+}
+
+static inline uint16_t get_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+void uart_rx_start(void);
+CmdSlot *rx_next_line(void);
+void rx_line_done(void);
+void baud_service(uint32_t current_time);
+
+uint16_t crc16(const uint8_t *data, uint16_t len);
+int cobs_decode(const uint8_t *src, uint16_t len, uint8_t *dst, uint16_t cap);
+uint8_t tx_send_frame(TxClass cls, const uint8_t *msg, uint16_t len);
+void log_to_buffer(const char* format, ...) __attribute__((format(printf, 1, 2)));
+void log_telemetry(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+void tick_frame_flush(void);
+void send_event(const GameEvent *ev);
+void emit_event(uint8_t kind, uint8_t type, int16_t x, int16_t y);
+void send_storm_param(void);
+void send_storm_sync(void);
+
+uint8_t rel_accept(uint16_t seq);
+void rel_on_ack(uint16_t seq);
+void rel_send_ack(void);
+void rel_service(uint32_t current_time);
+
+void cmd_proto(ProtoMode mode);
+void cmd_agg(uint8_t enable);
+void cmd_stats(void);
+void cmd_baud(uint32_t baud);
+void cmd_baud_probe(void);
+void cmd_rel(uint8_t enable);
+void cmd_ts(uint8_t enable);
+void cmd_ping(uint32_t browser_time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __COMM_H__ */
@@ -0,0 +1,30 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    commands.h
+  * @brief   This file contains all the function prototypes for
+  *          the commands.c file
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __COMMANDS_H__
+#define __COMMANDS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+void commands_init(void);
+void run_command(char *cmd);
+void run_frame(const uint8_t *data, uint8_t len);
+void handle_commands(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __COMMANDS_H__ */
@@ -0,0 +1,53 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    display.h
+  * @brief   This file contains all the function prototypes for
+  *          the display.c file
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DISPLAY_H__
+#define __DISPLAY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+#define DISP_DIGITS             4
+#define DISP_REFRESH_HZ         500     // whole display; TIM2 interrupts at 4x this
+#define DISP_REFRESH_MIN_HZ     60
+#define DISP_REFRESH_MAX_HZ     1000
+#define DISP_WAVE_WORDS         32      // 16 bits, two BSRR writes per bit
+#define DISP_DMA_WORD_HZ        4000000 // TIM3 pacing, the shift clock runs at half of it
+#define DISP_BLINK_MS           500     // time digits blink while paused
+#define DISP_BENCH_TIMEOUT_MS   10      // longest wait for the display DMA to go idle
+
+extern volatile uint8_t disp_buf[DISP_DIGITS];
+extern uint16_t disp_refresh_hz;
+extern volatile uint32_t last_blink_tick;
+extern volatile uint8_t display_on;
+
+void writeByteToDisplay(uint8_t z);
+void writeSegmentToDisplay(uint8_t z, uint8_t val);
+void displayInt(uint8_t value);
+void updateDisplay(void);
+void display_blink(uint32_t current_time);
+void display_set_refresh(uint16_t hz);
+void display_start(void);
+void dwt_init(void);
+uint8_t display_bench(uint32_t *hal, uint32_t *bsrr, uint32_t *dma);
+
+void cmd_disp_hz(uint16_t hz);
+void cmd_disp_dma(uint8_t enable);
+void cmd_disp_bench(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DISPLAY_H__ */
@@ -0,0 +1,132 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    game.h
+  * @brief   This file contains all the function prototypes for
+  *          the game.c file
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __GAME_H__
+#define __GAME_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "storm.h"
+
+#define FIELD_WIDTH             800
+#define FIELD_HEIGHT            600
+#ifndef MAX_SHIPS
+#define MAX_SHIPS               25      // up to 256 with the uint8_t ship_idx_t below
+#endif
+#define SHIP_MAP_WORDS          ((MAX_SHIPS + 31) / 32)
+#define SHIP_MAX_RADIUS         45
+#define GRID_CELL               SHIP_MAX_RADIUS     // a hit never reaches past the next cell
+#define GRID_COLS               (FIELD_WIDTH / GRID_CELL + 1)
+#define GRID_ROWS               (FIELD_HEIGHT / GRID_CELL + 1)
+#define GRID_NONE               0xFFFF
+#define BTN_FIFO_SIZE           16      // power of two
+#define STORM_SYNC_INTERVAL_MS  2000
+
+// Crosshair movement
+#define CROSSHAIR_STEP_X        25
+#define CROSSHAIR_STEP_Y        3
+#define MIN_X                   40
+#define MAX_X                   (FIELD_WIDTH - 40)
+#define MIN_Y                   40
+#define MAX_Y                   (FIELD_HEIGHT - 40)
+
+typedef enum {
+    BTN_LEFT = 0,
+    BTN_RIGHT,
+    BTN_MIDDLE,
+    BTN_COUNT
+} ButtonId;
+
+// Press captured in the EXTI interrupt
+typedef struct {
+    uint8_t button;
+    uint32_t tick;
+} ButtonEvent;
+
+#if MAX_SHIPS > 256
+#error "MAX_SHIPS above 256 needs a wider ship_idx_t"
+#endif
+#if SHIP_MAP_WORDS > 32
+#error "ship_free_summary has one bit per bitmap word"
+#endif
+typedef uint8_t ship_idx_t;
+
+// A slot is live while it is listed in ship_list; pos is its place there
+// and next links it to the other ships in its grid cell
+typedef struct {
+    uint8_t type;
+    ship_idx_t pos;
+    uint16_t x;
+    uint16_t y;
+    uint16_t next;
+} Ship;
+
+// PCG32 (XSH RR): 64-bit LCG state, 32-bit permuted output
+typedef struct {
+    uint64_t state;
+    uint64_t inc;
+} Pcg32;
+
+extern volatile uint8_t game_started;
+extern volatile uint8_t game_paused;
+extern volatile uint8_t game_time;
+extern volatile uint32_t last_second_tick;
+extern volatile uint32_t last_ship_spawn;
+extern uint32_t crosshair_locked;
+extern uint32_t crosshair_x;
+extern uint32_t crosshair_y;
+extern Ship ships[MAX_SHIPS];
+extern ship_idx_t ship_list[MAX_SHIPS];
+extern uint32_t ship_count;
+extern uint16_t ship_grid[GRID_ROWS * GRID_COLS];
+extern uint32_t rng_seed;
+extern StormParams storm;
+extern volatile uint8_t storm_param_mode;
+extern volatile uint32_t last_storm_update;
+extern volatile uint32_t last_storm_sync;
+extern volatile uint32_t storm_update_interval_ms;
+
+uint32_t rng_next(void);
+uint32_t rng_below(uint32_t n);
+void rng_set_seed(uint32_t seed);
+// Board specific: the seed used when no CMD:SEED is pending
+uint32_t rng_entropy(void);
+
+void ship_pool_reset(void);
+int ship_alloc(void);
+void ship_free(uint32_t slot);
+void grid_insert(uint32_t slot);
+void grid_remove(uint32_t slot);
+void spawn_ship(void);
+void check_ship_hit(uint16_t ch_x, uint16_t ch_y);
+void get_storm_offsets(int16_t* out_x, int16_t* out_y);
+void update_game_logic(uint32_t current_time);
+
+void button_push(uint8_t button, uint32_t tick);
+void process_buttons(void);
+
+void cmd_start(void);
+void cmd_pause(void);
+void cmd_reset(void);
+void cmd_shot(uint16_t x, uint16_t y);
+void cmd_seed(uint32_t seed);
+void cmd_storm_update(int16_t delta_x, int16_t delta_y);
+void cmd_storm_mode(uint8_t parametric);
+void cmd_storm_hz(uint16_t hz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GAME_H__ */
@@ -14,10 +14,36 @@ extern "C" {
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+// Build switch, ahead of the types and macros it selects
+#ifndef PROFILE_ENABLE
+#define PROFILE_ENABLE          0       // DWT cycle profiling of the main loop, CMD:PROF
+#endif
 /* USER CODE END Includes */
 
 /* Exported types ------------------------------------------------------------*/
 /* USER CODE BEGIN ET */
+// Main loop wake-up reasons, each one a byte flag set from an interrupt
+typedef enum {
+    EVT_RX = 0,         // command line queued, or an RX error to look at
+    EVT_TX,             // TX transfer finished
+    EVT_BUTTON,         // button press queued
+    EVT_TIMER,          // loop_deadline reached
+    EVT_COUNT
+} LoopEvent;
+
+#if PROFILE_ENABLE
+typedef enum {
+    PROF_RX,            // handle_commands()
+    PROF_SERVICE,       // baud_service() + rel_service()
+    PROF_BUTTONS,       // process_buttons()
+    PROF_GAME,          // update_game_logic()
+    PROF_FLUSH,         // tick_frame_flush()
+    PROF_DISPLAY,       // blink + updateDisplay()
+    PROF_LOOP,          // start to start of a pass, sleep included
+    PROF_WAKE,          // SysTick raising EVT_TIMER to the pass starting
+    PROF_STAGE_COUNT
+} ProfStage;
+#endif
 /* USER CODE END ET */
 
 /* Exported constants --------------------------------------------------------*/
@@ -26,12 +52,31 @@ extern "C" {
 
 /* Exported macro ------------------------------------------------------------*/
 /* USER CODE BEGIN EM */
+// Stage timing around main-loop code; nothing is left of it unless
+// PROFILE_ENABLE is set
+#if PROFILE_ENABLE
+#define PROF_BEGIN()            (prof_t0 = DWT->CYCCNT)
+#define PROF_END(stage)         prof_record((stage), DWT->CYCCNT - prof_t0)
+#else
+#define PROF_BEGIN()            ((void)0)
+#define PROF_END(stage)         ((void)0)
+#endif
 /* USER CODE END EM */
 
 /* Exported functions prototypes ---------------------------------------------*/
 void Error_Handler(void);
 
 /* USER CODE BEGIN EFP */
+extern volatile uint8_t loop_event[EVT_COUNT];
+
+void loop_systick(void);
+void cmd_status(void);
+#if PROFILE_ENABLE
+extern uint32_t prof_t0;
+void prof_record(ProfStage stage, uint32_t cycles);
+void cmd_prof(void);
+void cmd_prof_reset(void);
+#endif
 /* USER CODE END EFP */
 
 /* Private defines -----------------------------------------------------------*/
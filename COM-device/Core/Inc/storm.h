@@ -0,0 +1,41 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    storm.h
+  * @brief   This file contains all the function prototypes for
+  *          the storm.c file
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STORM_H__
+#define __STORM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Angles are binary: 65536 units make one full turn, so phase arithmetic
+   wraps for free in a uint16_t */
+#define STORM_ANGLE_TURN        65536UL
+
+typedef struct {
+    int16_t  amp_x;         // pixels
+    int16_t  amp_y;
+    uint16_t period_x_ms;
+    uint16_t period_y_ms;
+    uint16_t phase_y_mrad;  // as sent in STORM_PARAM
+} StormParams;
+
+int16_t storm_sin_q15(uint16_t angle);
+uint16_t storm_mrad_to_angle(uint16_t mrad);
+void storm_offsets(const StormParams *p, uint32_t tick, int16_t *out_x, int16_t *out_y);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STORM_H__ */
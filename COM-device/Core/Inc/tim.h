@@ -35,13 +35,14 @@ extern "C" {
 extern TIM_HandleTypeDef htim2;
 
 /* USER CODE BEGIN Private defines */
-
+extern TIM_HandleTypeDef htim3;
+extern DMA_HandleTypeDef hdma_tim3_up;
 /* USER CODE END Private defines */
 
 void MX_TIM2_Init(void);
 
 /* USER CODE BEGIN Prototypes */
-
+void MX_TIM3_DisplayDMA_Init(uint32_t word_rate_hz);
 /* USER CODE END Prototypes */
 
 #ifdef __cplusplus
@@ -0,0 +1,93 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    app.c
+  * @brief   One pass of the main loop. main() and the host builds call
+  *          app_pass() with the events taken since the previous pass.
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+/* Includes ------------------------------------------------------------------*/
+#include "app.h"
+#include "comm.h"
+#include "commands.h"
+#include "game.h"
+#include "display.h"
+
+void app_init(void) {
+    /* Initialize UART DMA */
+    commands_init();
+    uart_rx_start();
+
+    /* Display multiplexing on TIM2 */
+    display_start();
+
+    /* Initial state */
+    ship_pool_reset();
+    rng_set_seed(rng_entropy());
+    last_second_tick = HAL_GetTick();
+    last_blink_tick = HAL_GetTick();
+}
+
+void app_pass(uint32_t current_time, uint8_t rx, uint8_t button, uint8_t timer) {
+    // =============== SERIAL COMMUNICATION ===============
+    if (rx) {
+        PROF_BEGIN();
+        handle_commands();
+        PROF_END(PROF_RX);
+    }
+    PROF_BEGIN();
+    baud_service(current_time);
+    rel_service(current_time);
+    PROF_END(PROF_SERVICE);
+
+    // =============== INPUT HANDLING ===============
+    if (button) {
+        PROF_BEGIN();
+        process_buttons();
+        PROF_END(PROF_BUTTONS);
+    }
+
+    // =============== GAME LOGIC ===============
+    if (timer) {
+        PROF_BEGIN();
+        update_game_logic(current_time);
+        PROF_END(PROF_GAME);
+    }
+    PROF_BEGIN();
+    tick_frame_flush();
+    PROF_END(PROF_FLUSH);
+
+    // =============== DISPLAY ===============
+    PROF_BEGIN();
+    display_blink(current_time);
+    updateDisplay();
+    PROF_END(PROF_DISPLAY);
+}
+
+#define WAKE_AT(t)  do { if ((int32_t)((t) - next) < 0) next = (t); } while (0)
+
+// Earliest tick at which a time-driven stage has work to do
+uint32_t loop_next_deadline(uint32_t current_time) {
+    uint32_t next = current_time + LOOP_MAX_SLEEP_MS;
+
+    if (game_started && !game_paused) {
+        WAKE_AT(last_ship_spawn + 4000);
+        WAKE_AT(last_second_tick + 1000);
+        if (storm_param_mode) {
+            WAKE_AT(last_storm_sync + STORM_SYNC_INTERVAL_MS);
+        } else {
+            WAKE_AT(last_storm_update + storm_update_interval_ms);
+        }
+    }
+    if (game_started && game_paused) {
+        WAKE_AT(last_blink_tick + DISP_BLINK_MS);
+    }
+    if (rel_tx_next != rel_tx_base) {
+        WAKE_AT(rel_window[rel_tx_base & (REL_WINDOW - 1)].sent_at + REL_RTO_MS);
+    }
+    if (baud_probing) {
+        WAKE_AT(baud_probe_deadline);
+    }
+    return next;
+}
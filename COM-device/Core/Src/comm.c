@@ -0,0 +1,718 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    comm.c
+  * @brief   UART link to the browser: command reception, the TX ring, ASCII
+  *          and binary (COBS) encodings, game events, the reliable channel
+  *          and baud rate switching.
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+/* Includes ------------------------------------------------------------------*/
+#include "comm.h"
+#include "usart.h"
+#include "game.h"
+#include "string.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+// UART DMA
+extern DMA_HandleTypeDef hdma_usart2_rx;
+extern DMA_HandleTypeDef hdma_usart2_tx;
+uint8_t rx_dma_buffer[RX_BUFFER_SIZE] = {0};
+uint16_t rx_dma_pos = 0;
+uint8_t rx_line_overflow = 0;
+uint8_t rx_after_delim = 0;     // last byte was a 0x00 frame delimiter
+
+// Received command lines: the RX interrupt fills cmd_queue[cmd_head],
+// handle_commands() consumes from cmd_tail
+CmdSlot cmd_queue[CMD_QUEUE_SIZE] = {0};
+volatile uint8_t cmd_head = 0;
+volatile uint8_t cmd_tail = 0;
+volatile uint32_t rx_line_count = 0;
+volatile uint32_t rx_overflow_count = 0;
+volatile uint32_t rx_drop_count = 0;
+uint32_t rx_crc_error_count = 0;
+
+// UART TX ring: log_to_buffer() appends at tx_head, DMA drains from tx_tail.
+// Both are free-running and wrap at 65536, a multiple of TX_RING_SIZE.
+uint8_t tx_ring[TX_RING_SIZE];
+volatile uint16_t tx_head = 0;
+volatile uint16_t tx_tail = 0;
+volatile uint16_t tx_dma_len = 0;
+uint16_t tx_high_water = 0;
+uint32_t tx_drop_count[TX_CLASS_COUNT] = {0};
+// Set while a new baud rate is waiting for CMD:BAUD_PROBE: output stays
+// queued so nothing is sent before the browser listens at the new rate
+volatile uint8_t tx_hold = 0;
+
+// Baud rate negotiation
+static const uint32_t baud_supported[] = {115200, 230400, 460800, 921600, 1000000, 2000000};
+uint32_t baud_pending = 0;              // acknowledged, applied once TX drains
+uint8_t baud_probing = 0;
+uint32_t baud_probe_deadline = 0;
+volatile uint8_t baud_rx_error = 0;     // RX error seen at a non-default rate
+
+// Outgoing encoding, switched by CMD:PROTO. Incoming frames are accepted in
+// either encoding at any time.
+volatile ProtoMode proto_mode = PROTO_ASCII;
+
+// Per-tick telemetry aggregation, switched by CMD:AGG
+uint8_t tel_aggregate = 0;
+TickFrame tick_frame = {0};
+
+// Event timestamps, switched by CMD:TS
+uint8_t ts_enabled = 0;
+
+// Reliable channel. Sequence numbers are free-running uint16 on both sides;
+// ACKs are cumulative and name the last sequence number received in order.
+uint8_t rel_enabled = 0;
+RelEntry rel_window[REL_WINDOW];
+uint16_t rel_tx_base = 0;           // oldest unacknowledged event
+uint16_t rel_tx_next = 0;           // sequence number of the next event
+uint16_t rel_rx_next = 0;           // next command sequence number expected
+uint8_t rel_ack_pending = 0;
+uint32_t rel_retransmit_count = 0;
+uint32_t rel_dup_count = 0;
+uint32_t rel_overflow_count = 0;
+
+// Logging
+volatile uint8_t logging_enabled = 1;
+
+// =============== UART / LOGGING ===============
+// Starts a DMA transfer of the largest contiguous span waiting in the ring.
+// Must run with interrupts disabled or from the TX completion interrupt.
+static void tx_kick(void) {
+    if (tx_dma_len != 0 || tx_hold) return;
+    uint16_t used = tx_head - tx_tail;
+    if (used == 0) return;
+
+    uint16_t start = tx_tail & (TX_RING_SIZE - 1);
+    uint16_t span = TX_RING_SIZE - start;
+    if (span > used) span = used;
+
+    tx_dma_len = span;
+    if (HAL_UART_Transmit_DMA(&huart2, &tx_ring[start], span) != HAL_OK) {
+        tx_dma_len = 0;
+    }
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+    if (huart->Instance == USART2) {
+        tx_tail += tx_dma_len;
+        tx_dma_len = 0;
+        tx_kick();
+        loop_event[EVT_TX] = 1;
+    }
+}
+
+// Appends a whole message to the TX ring or drops it whole, never a part
+static uint8_t tx_enqueue(TxClass cls, const uint8_t *data, uint16_t len) {
+    uint16_t used = tx_head - tx_tail;
+    uint16_t reserve = (cls == TX_CLASS_EVENT) ? 0 : TX_EVENT_RESERVE;
+    if ((uint32_t)used + len + reserve > TX_RING_SIZE) {
+        tx_drop_count[cls]++;
+        return 0;
+    }
+
+    uint16_t start = tx_head & (TX_RING_SIZE - 1);
+    uint16_t first = TX_RING_SIZE - start;
+    if (first > len) first = len;
+    memcpy(&tx_ring[start], data, first);
+    memcpy(tx_ring, data + first, len - first);
+
+    used += len;
+    if (used > tx_high_water) tx_high_water = used;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    tx_head += len;
+    tx_kick();
+    __set_PRIMASK(primask);
+    return 1;
+}
+
+// =============== BINARY FRAMING ===============
+// Binary frames are COBS(message + CRC16 little-endian) followed by 0x00.
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), a nibble table keeps flash small.
+static const uint16_t crc16_nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+uint16_t crc16(const uint8_t *data, uint16_t len) {
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+        crc = (crc << 4) ^ crc16_nibble[(crc >> 12) ^ (*data >> 4)];
+        crc = (crc << 4) ^ crc16_nibble[(crc >> 12) ^ (*data & 0x0F)];
+        data++;
+    }
+    return crc;
+}
+
+static uint16_t cobs_encode(const uint8_t *src, uint16_t len, uint8_t *dst) {
+    uint16_t code_pos = 0;
+    uint16_t write = 1;
+    uint8_t code = 1;
+
+    for (uint16_t read = 0; read < len; read++) {
+        if (src[read] == 0) {
+            dst[code_pos] = code;
+            code = 1;
+            code_pos = write++;
+        } else {
+            dst[write++] = src[read];
+            if (++code == 0xFF) {
+                dst[code_pos] = code;
+                code = 1;
+                code_pos = write++;
+            }
+        }
+    }
+    dst[code_pos] = code;
+    return write;
+}
+
+// Returns the decoded length, or -1 for a malformed frame
+int cobs_decode(const uint8_t *src, uint16_t len, uint8_t *dst, uint16_t cap) {
+    uint16_t read = 0;
+    uint16_t write = 0;
+
+    while (read < len) {
+        uint8_t code = src[read++];
+        if (code == 0) return -1;
+        for (uint8_t i = 1; i < code; i++) {
+            if (read >= len || write >= cap) return -1;
+            dst[write++] = src[read++];
+        }
+        if (code != 0xFF && read < len) {
+            if (write >= cap) return -1;
+            dst[write++] = 0;
+        }
+    }
+    return write;
+}
+
+uint8_t tx_send_frame(TxClass cls, const uint8_t *msg, uint16_t len) {
+    uint8_t raw[TX_LINE_SIZE + 2];
+    uint8_t frame[FRAME_MAX_SIZE];
+    if (len > TX_LINE_SIZE) return 0;
+
+    memcpy(raw, msg, len);
+    put_le16(&raw[len], crc16(msg, len));
+    uint16_t frame_len = cobs_encode(raw, len + 2, frame);
+    frame[frame_len++] = 0x00;
+    return tx_enqueue(cls, frame, frame_len);
+}
+
+static void vlog_to_buffer(TxClass cls, const char* format, va_list args) {
+    if (!logging_enabled) return;
+    char line[TX_LINE_SIZE];
+
+    // line[0] is left free for the MSG_TEXT header of the binary protocol
+    int len = vsnprintf(line + 1, sizeof(line) - 3, format, args);
+    if (len <= 0) return;
+    if (len > (int)sizeof(line) - 4) len = sizeof(line) - 4;   // truncated
+
+    if (proto_mode == PROTO_BINARY) {
+        line[0] = MSG_TEXT;
+        tx_send_frame(cls, (const uint8_t*)line, (uint16_t)(len + 1));
+        return;
+    }
+    line[len + 1] = '\r';
+    line[len + 2] = '\n';
+    tx_enqueue(cls, (const uint8_t*)line + 1, (uint16_t)(len + 2));
+}
+
+static void log_class(TxClass cls, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vlog_to_buffer(cls, format, args);
+    va_end(args);
+}
+
+void log_to_buffer(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vlog_to_buffer(TX_CLASS_EVENT, format, args);
+    va_end(args);
+}
+
+// Periodic samples that are superseded by the next one anyway
+void log_telemetry(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vlog_to_buffer(TX_CLASS_TELEMETRY, format, args);
+    va_end(args);
+}
+
+// =============== GAME EVENTS ===============
+static uint8_t event_msg_type(uint8_t kind) {
+    switch (kind) {
+    case EV_SHIP: return MSG_SHIP;
+    case EV_HIT:  return MSG_HIT;
+    case EV_MISS: return MSG_MISS;
+    default:      return 0;
+    }
+}
+
+// Sends the collected TICK frame, if anything happened since the last one.
+// The frame always carries the remaining time and the latest storm offset.
+void tick_frame_flush(void) {
+    if (!tick_frame.pending) return;
+    TxClass cls = tick_frame.count ? TX_CLASS_EVENT : TX_CLASS_TELEMETRY;
+
+    if (proto_mode == PROTO_BINARY) {
+        uint8_t msg[7 + TICK_MAX_EVENTS * 6 + 4];
+        uint16_t len = 0;
+        msg[len++] = MSG_TICK;
+        msg[len++] = game_time;
+        put_le16(&msg[len], (uint16_t)tick_frame.storm_x); len += 2;
+        put_le16(&msg[len], (uint16_t)tick_frame.storm_y); len += 2;
+        msg[len++] = tick_frame.count;
+        for (uint8_t i = 0; i < tick_frame.count; i++) {
+            const GameEvent *ev = &tick_frame.events[i];
+            msg[len++] = event_msg_type(ev->kind);
+            msg[len++] = ev->type;
+            put_le16(&msg[len], (uint16_t)ev->x); len += 2;
+            put_le16(&msg[len], (uint16_t)ev->y); len += 2;
+        }
+        if (ts_enabled) {
+            put_le32(&msg[len], tick_frame.tick); len += 4;
+        }
+        tx_send_frame(cls, msg, len);
+    } else {
+        char line[TX_LINE_SIZE];
+        int len = snprintf(line, sizeof(line), "TICK:%d,%d,%d", game_time,
+                           tick_frame.storm_x, tick_frame.storm_y);
+        for (uint8_t i = 0; i < tick_frame.count && len < (int)sizeof(line); i++) {
+            const GameEvent *ev = &tick_frame.events[i];
+            if (ev->kind == EV_MISS) {
+                len += snprintf(line + len, sizeof(line) - len, ";M:%d,%d", ev->x, ev->y);
+            } else {
+                len += snprintf(line + len, sizeof(line) - len, ";%c:%d,%d,%d",
+                                (ev->kind == EV_SHIP) ? 'S' : 'H', ev->type, ev->x, ev->y);
+            }
+        }
+        if (ts_enabled && len < (int)sizeof(line)) {
+            snprintf(line + len, sizeof(line) - len, "@%lu", (unsigned long)tick_frame.tick);
+        }
+        log_class(cls, "%s", line);
+    }
+
+    tick_frame.pending = 0;
+    tick_frame.count = 0;
+}
+
+static void tick_frame_add(const GameEvent *ev) {
+    switch (ev->kind) {
+    case EV_STORM:
+        tick_frame.storm_x = ev->x;
+        tick_frame.storm_y = ev->y;
+        break;
+    case EV_TIME:
+        break;      // game_time goes into every frame anyway
+    default:
+        if (tick_frame.count == TICK_MAX_EVENTS) tick_frame_flush();
+        tick_frame.events[tick_frame.count++] = *ev;
+        break;
+    }
+    tick_frame.tick = ev->tick;
+    tick_frame.pending = 1;
+}
+
+// Encodes one event for the active protocol. seq >= 0 wraps it for the
+// reliable channel: R:<seq>: in front of the line, or a MSG_REL frame.
+static void encode_event(const GameEvent *ev, int32_t seq) {
+    TxClass cls = (ev->kind == EV_STORM) ? TX_CLASS_TELEMETRY : TX_CLASS_EVENT;
+
+    if (proto_mode == PROTO_BINARY) {
+        uint8_t msg[13];
+        uint16_t len = 0;
+        if (seq >= 0) {
+            msg[len++] = MSG_REL;
+            put_le16(&msg[len], (uint16_t)seq); len += 2;
+        }
+        switch (ev->kind) {
+        case EV_TIME:
+            msg[len++] = MSG_TIME;
+            msg[len++] = ev->type;
+            break;
+        case EV_SHIP:
+        case EV_HIT:
+            msg[len++] = event_msg_type(ev->kind);
+            msg[len++] = ev->type;
+            put_le16(&msg[len], (uint16_t)ev->x); len += 2;
+            put_le16(&msg[len], (uint16_t)ev->y); len += 2;
+            break;
+        case EV_MISS:
+        case EV_STORM:
+            msg[len++] = (ev->kind == EV_MISS) ? MSG_MISS : MSG_STORM;
+            put_le16(&msg[len], (uint16_t)ev->x); len += 2;
+            put_le16(&msg[len], (uint16_t)ev->y); len += 2;
+            break;
+        default:
+            return;
+        }
+        if (ts_enabled) {
+            put_le32(&msg[len], ev->tick); len += 4;
+        }
+        tx_send_frame(cls, msg, len);
+        return;
+    }
+
+    char rel[12] = "";
+    char ts[12] = "";
+    if (seq >= 0) {
+        snprintf(rel, sizeof(rel), "R:%u:", (uint16_t)seq);
+    }
+    if (ts_enabled) {
+        snprintf(ts, sizeof(ts), "@%lu", (unsigned long)ev->tick);
+    }
+    switch (ev->kind) {
+    case EV_TIME:  log_to_buffer("TIME:%d%s", ev->type, ts); break;
+    case EV_SHIP:  log_to_buffer("%sSHIP:%d,%d,%d%s", rel, ev->type, ev->x, ev->y, ts); break;
+    case EV_HIT:   log_to_buffer("%sRESULT:HIT:%d,%d,%d%s", rel, ev->type, ev->x, ev->y, ts); break;
+    case EV_MISS:  log_to_buffer("%sRESULT:MISS,%d,%d%s", rel, ev->x, ev->y, ts); break;
+    case EV_STORM: log_telemetry("STORM:%d,%d%s", ev->x, ev->y, ts); break;
+    default: break;
+    }
+}
+
+// SHIP and RESULT change score and ship state on both sides; TIME and STORM
+// are superseded by the next sample anyway
+static uint8_t event_is_critical(uint8_t kind) {
+    return kind == EV_SHIP || kind == EV_HIT || kind == EV_MISS;
+}
+
+static void rel_send(const GameEvent *ev) {
+    if ((uint16_t)(rel_tx_next - rel_tx_base) >= REL_WINDOW) {
+        // Peer stopped acknowledging: degrade to a plain event
+        rel_overflow_count++;
+        encode_event(ev, -1);
+        return;
+    }
+    uint16_t seq = rel_tx_next++;
+    RelEntry *entry = &rel_window[seq & (REL_WINDOW - 1)];
+    entry->ev = *ev;
+    entry->sent_at = HAL_GetTick();
+    encode_event(ev, seq);
+}
+
+void send_event(const GameEvent *ev) {
+    if (rel_enabled && event_is_critical(ev->kind)) {
+        // Sent on their own so each one can be acknowledged and resent
+        rel_send(ev);
+        return;
+    }
+    if (tel_aggregate) {
+        tick_frame_add(ev);
+        return;
+    }
+    encode_event(ev, -1);
+}
+
+void emit_event(uint8_t kind, uint8_t type, int16_t x, int16_t y) {
+    GameEvent ev = { kind, type, x, y, HAL_GetTick() };
+    send_event(&ev);
+}
+
+// =============== STORM SYNC ===============
+// Everything the browser needs to reproduce get_storm_offsets() locally,
+// tied to the device tick at which it was sent
+void send_storm_param(void) {
+    uint32_t tick = HAL_GetTick();
+    uint8_t amp_x = (uint8_t)storm.amp_x;
+    uint8_t amp_y = (uint8_t)storm.amp_y;
+
+    if (proto_mode == PROTO_BINARY) {
+        uint8_t msg[13];
+        msg[0] = MSG_STORM_PARAM;
+        msg[1] = amp_x;
+        msg[2] = amp_y;
+        put_le16(&msg[3], storm.period_x_ms);
+        put_le16(&msg[5], storm.period_y_ms);
+        put_le16(&msg[7], storm.phase_y_mrad);
+        put_le32(&msg[9], tick);
+        tx_send_frame(TX_CLASS_EVENT, msg, sizeof(msg));
+    } else {
+        log_to_buffer("STORM_PARAM:%d,%d,%d,%d,%d,%lu", amp_x, amp_y,
+                      storm.period_x_ms, storm.period_y_ms,
+                      storm.phase_y_mrad, (unsigned long)tick);
+    }
+}
+
+// Periodic tick reference so the browser can correct clock drift
+void send_storm_sync(void) {
+    uint32_t tick = HAL_GetTick();
+    if (proto_mode == PROTO_BINARY) {
+        uint8_t msg[5];
+        msg[0] = MSG_STORM_SYNC;
+        put_le32(&msg[1], tick);
+        tx_send_frame(TX_CLASS_TELEMETRY, msg, sizeof(msg));
+    } else {
+        log_telemetry("STORM_SYNC:%lu", (unsigned long)tick);
+    }
+}
+
+// =============== RELIABLE CHANNEL ===============
+// Go-back-N in both directions: commands are run only in sequence order
+// (duplicates and anything after a gap are dropped and re-acknowledged), and
+// events not acknowledged within REL_RTO_MS are all sent again in order.
+uint8_t rel_accept(uint16_t seq) {
+    rel_ack_pending = 1;
+    if (seq == rel_rx_next) {
+        rel_rx_next++;
+        return 1;
+    }
+    if ((int16_t)(seq - rel_rx_next) < 0) {
+        rel_dup_count++;
+    }
+    return 0;
+}
+
+void rel_on_ack(uint16_t seq) {
+    uint16_t acked = seq + 1;
+    // Ignore stale ACKs and ACKs for events that were never sent
+    if ((int16_t)(acked - rel_tx_base) > 0 && (int16_t)(rel_tx_next - acked) >= 0) {
+        rel_tx_base = acked;
+    }
+}
+
+void rel_send_ack(void) {
+    uint16_t seq = rel_rx_next - 1;
+    rel_ack_pending = 0;
+    if (proto_mode == PROTO_BINARY) {
+        uint8_t msg[3] = { MSG_ACK, (uint8_t)seq, (uint8_t)(seq >> 8) };
+        tx_send_frame(TX_CLASS_EVENT, msg, sizeof(msg));
+    } else {
+        log_to_buffer("ACK:%u", seq);
+    }
+}
+
+void rel_service(uint32_t current_time) {
+    if (rel_tx_next == rel_tx_base) return;
+    if (current_time - rel_window[rel_tx_base & (REL_WINDOW - 1)].sent_at < REL_RTO_MS) return;
+
+    for (uint16_t seq = rel_tx_base; seq != rel_tx_next; seq++) {
+        RelEntry *entry = &rel_window[seq & (REL_WINDOW - 1)];
+        entry->sent_at = current_time;
+        encode_event(&entry->ev, seq);
+        rel_retransmit_count++;
+    }
+}
+
+// =============== UART RECEIVE ===============
+// Reception runs entirely from interrupts: the DMA channel fills rx_dma_buffer
+// circularly and HAL reports IDLE-line, half- and full-transfer events through
+// HAL_UARTEx_RxEventCallback. The game loop only sees complete lines.
+void uart_rx_start(void) {
+    rx_dma_pos = 0;
+    rx_line_overflow = 0;
+    rx_after_delim = 0;
+    cmd_queue[cmd_head].len = 0;
+    HAL_UARTEx_ReceiveToIdle_DMA(&huart2, rx_dma_buffer, RX_BUFFER_SIZE);
+}
+
+static void rx_feed_byte(uint8_t ch) {
+    CmdSlot *slot = &cmd_queue[cmd_head];
+
+    // The browser opens every COBS frame with a 0x00, so a frame is a slot
+    // whose first byte follows a delimiter and is a code byte below ' '
+    // (binary commands are far shorter than that). Only 0x00 ends a frame,
+    // since its bytes may be CR/LF; every other slot is a text line ended by
+    // CR/LF. An overlong frame is not one and ends at CR/LF too.
+    if (slot->len == 0) {
+        slot->is_frame = rx_after_delim && ch != 0x00 && ch < ' ';
+    }
+    rx_after_delim = (ch == 0x00);
+    uint8_t is_text = !slot->is_frame || rx_line_overflow;
+
+    if (ch == 0x00 || (is_text && (ch == '\r' || ch == '\n'))) {
+        if (rx_line_overflow) {
+            // Line did not fit in a slot: dropped as a whole
+            rx_overflow_count++;
+        } else if (slot->len > 0) {
+            uint8_t next = (cmd_head + 1) & (CMD_QUEUE_SIZE - 1);
+            if (next == cmd_tail) {
+                rx_drop_count++;
+            } else {
+                slot->text[slot->len] = '\0';
+                cmd_head = next;
+                rx_line_count++;
+                loop_event[EVT_RX] = 1;
+            }
+        }
+        cmd_queue[cmd_head].len = 0;
+        rx_line_overflow = 0;
+    } else if (slot->len < CMD_LINE_SIZE - 1) {
+        slot->text[slot->len++] = ch;
+    } else {
+        rx_line_overflow = 1;
+    }
+}
+
+// Oldest complete line, or NULL; it stays queued until rx_line_done()
+CmdSlot *rx_next_line(void) {
+    return (cmd_tail != cmd_head) ? &cmd_queue[cmd_tail] : NULL;
+}
+
+void rx_line_done(void) {
+    cmd_tail = (cmd_tail + 1) & (CMD_QUEUE_SIZE - 1);
+}
+
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
+    if (huart->Instance != USART2) return;
+    (void)Size;
+
+    // Take the position from the DMA counter rather than Size: a late IDLE
+    // event may be serviced after the buffer has already wrapped
+    uint16_t pos = RX_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(huart->hdmarx);
+    if (pos >= RX_BUFFER_SIZE) pos = 0;
+
+    while (rx_dma_pos != pos) {
+        rx_feed_byte(rx_dma_buffer[rx_dma_pos]);
+        rx_dma_pos = (rx_dma_pos + 1) % RX_BUFFER_SIZE;
+    }
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+    // HAL aborts the DMA reception on overrun/framing errors; re-arm it
+    if (huart->Instance == USART2) {
+        if (huart2.Init.BaudRate != UART_DEFAULT_BAUD) {
+            baud_rx_error = 1;
+            loop_event[EVT_RX] = 1;
+        }
+        uart_rx_start();
+    }
+}
+
+// =============== UART BAUD RATE ===============
+// CMD:BAUD:<rate> is acknowledged at the old rate, then USART2 switches once
+// the acknowledgement has left the shift register. The browser reopens its
+// port and sends CMD:BAUD_PROBE; without it both sides return to 115200.
+static void uart_set_baud(uint32_t baud) {
+    HAL_UART_Abort(&huart2);
+
+    // An aborted transfer is lost anyway, skip it rather than resend half
+    __disable_irq();
+    tx_tail += tx_dma_len;
+    tx_dma_len = 0;
+    __enable_irq();
+
+    huart2.Init.BaudRate = baud;
+    if (HAL_UART_Init(&huart2) != HAL_OK) {
+        Error_Handler();
+    }
+    uart_rx_start();
+}
+
+static uint8_t tx_idle(void) {
+    return tx_head == tx_tail && tx_dma_len == 0 &&
+           __HAL_UART_GET_FLAG(&huart2, UART_FLAG_TC);
+}
+
+static void tx_release(void) {
+    __disable_irq();
+    tx_hold = 0;
+    tx_kick();
+    __enable_irq();
+}
+
+static void baud_fallback(void) {
+    baud_pending = 0;
+    baud_probing = 0;
+    baud_rx_error = 0;
+    uart_set_baud(UART_DEFAULT_BAUD);
+    tx_release();
+    log_to_buffer("BAUD:FALLBACK:%lu", (unsigned long)UART_DEFAULT_BAUD);
+}
+
+void baud_service(uint32_t current_time) {
+    if (baud_pending && tx_idle()) {
+        __disable_irq();
+        tx_hold = 1;
+        __enable_irq();
+        uart_set_baud(baud_pending);
+        baud_pending = 0;
+        baud_probing = 1;
+        baud_rx_error = 0;
+        baud_probe_deadline = current_time + BAUD_PROBE_TIMEOUT_MS;
+    }
+    else if (baud_probing && (int32_t)(current_time - baud_probe_deadline) >= 0) {
+        baud_fallback();
+    }
+    else if (baud_rx_error && !baud_probing) {
+        // Line noise at a negotiated rate usually means a browser reconnected
+        // at the default rate, so go back to where it expects us
+        baud_fallback();
+    }
+}
+
+// =============== COMMANDS ===============
+void cmd_proto(ProtoMode mode) {
+    // The acknowledgement goes out in the old encoding, everything after it
+    // in the new one, so the browser can switch at exactly this point
+    log_to_buffer("PROTO:%s", (mode == PROTO_BINARY) ? "BIN" : "ASCII");
+    proto_mode = mode;
+}
+
+void cmd_agg(uint8_t enable) {
+    tick_frame_flush();
+    tel_aggregate = enable ? 1 : 0;
+    log_to_buffer("AGG:%d", tel_aggregate);
+}
+
+void cmd_stats(void) {
+    log_to_buffer("STATS:RX:%lu,%lu,%lu,%lu", (unsigned long)rx_line_count,
+                  (unsigned long)rx_overflow_count, (unsigned long)rx_drop_count,
+                  (unsigned long)rx_crc_error_count);
+    log_to_buffer("STATS:TX:%u,%u,%lu,%lu", (uint16_t)(tx_head - tx_tail), tx_high_water,
+                  (unsigned long)tx_drop_count[TX_CLASS_EVENT],
+                  (unsigned long)tx_drop_count[TX_CLASS_TELEMETRY]);
+    log_to_buffer("STATS:REL:%u,%lu,%lu,%lu", (uint16_t)(rel_tx_next - rel_tx_base),
+                  (unsigned long)rel_retransmit_count, (unsigned long)rel_dup_count,
+                  (unsigned long)rel_overflow_count);
+}
+
+void cmd_baud(uint32_t baud) {
+    uint8_t supported = 0;
+    for (uint32_t i = 0; i < sizeof(baud_supported) / sizeof(baud_supported[0]); i++) {
+        if (baud_supported[i] == baud) supported = 1;
+    }
+    if (!supported || baud_pending || baud_probing) {
+        log_to_buffer("BAUD:ERR:%lu", (unsigned long)baud);
+        return;
+    }
+    log_to_buffer("BAUD:ACK:%lu", (unsigned long)baud);
+    baud_pending = baud;
+}
+
+void cmd_baud_probe(void) {
+    // A repeated probe after confirmation is simply confirmed again
+    log_to_buffer("BAUD:OK:%lu", (unsigned long)huart2.Init.BaudRate);
+    if (baud_probing) {
+        baud_probing = 0;
+        tx_release();
+    }
+}
+
+void cmd_rel(uint8_t enable) {
+    rel_enabled = enable ? 1 : 0;
+    rel_tx_base = rel_tx_next = 0;
+    rel_rx_next = 0;
+    rel_ack_pending = 0;
+    log_to_buffer("REL:%d", rel_enabled);
+}
+
+void cmd_ts(uint8_t enable) {
+    tick_frame_flush();
+    ts_enabled = enable ? 1 : 0;
+    log_to_buffer("TS:%d", ts_enabled);
+}
+
+// Answered from the main loop: the reply tick is late by at most one pass,
+// which the browser sees as part of the round trip
+void cmd_ping(uint32_t browser_time) {
+    log_to_buffer("PONG:%lu,%lu", (unsigned long)browser_time, (unsigned long)HAL_GetTick());
+}
@@ -0,0 +1,325 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    commands.c
+  * @brief   Text and binary command parsing and the command table.
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+/* Includes ------------------------------------------------------------------*/
+#include "commands.h"
+#include "comm.h"
+#include "game.h"
+#include "display.h"
+#include "string.h"
+
+#define CMD_MAX_ARGS            2
+
+// Argument schema of the text command table
+typedef enum {
+    ARG_INT = 0,        // decimal integer within [min, max]
+    ARG_WORD,           // one of words[], passed on as its index
+    ARG_TAIL            // rest of the line, passed on as a string
+} ArgKind;
+
+typedef enum {
+    ARG_OK = 0,
+    ARG_ERR_MISSING,
+    ARG_ERR_FORMAT,
+    ARG_ERR_RANGE,
+    ARG_ERR_EXTRA
+} ArgError;
+
+typedef struct {
+    uint8_t kind;
+    int32_t min;
+    int32_t max;
+    const char *const *words;
+} ArgSpec;
+
+typedef struct {
+    const char *name;
+    void (*handler)(const int32_t *arg, char *tail);
+    uint8_t argc;
+    ArgSpec args[CMD_MAX_ARGS];
+} CmdSpec;
+
+// =============== COMMAND TABLE ===============
+// Text commands are CMD:<NAME>[:<arg>[,<arg>]]. The table below is the only
+// place a command is registered: its name, handler and argument schema.
+// Arguments are checked before the handler runs; a bad one is answered with
+// ERR:<NAME>:<MISSING|FORMAT|RANGE|EXTRA>:<argument number, from 1>.
+#define INT_ARG(lo, hi)         { ARG_INT, (lo), (hi), NULL }
+#define WORD_ARG(words)         { ARG_WORD, 0, 0, (words) }
+#define TAIL_ARG                { ARG_TAIL, 0, 0, NULL }
+
+static const char *const storm_mode_words[] = { "SAMPLE", "PARAM", NULL };
+static const char *const proto_words[] = { "ASCII", "BIN", NULL };
+static const char *const arg_error_names[] = { "OK", "MISSING", "FORMAT", "RANGE", "EXTRA" };
+
+static void dispatch_command(char *line);
+
+static void on_start(const int32_t *arg, char *tail)   { (void)arg; (void)tail; cmd_start(); }
+static void on_pause(const int32_t *arg, char *tail)   { (void)arg; (void)tail; cmd_pause(); }
+static void on_reset(const int32_t *arg, char *tail)   { (void)arg; (void)tail; cmd_reset(); }
+static void on_stats(const int32_t *arg, char *tail)   { (void)arg; (void)tail; cmd_stats(); }
+static void on_shot(const int32_t *arg, char *tail)    { (void)tail; cmd_shot(arg[0], arg[1]); }
+static void on_storm_update(const int32_t *arg, char *tail) { (void)tail; cmd_storm_update(arg[0], arg[1]); }
+static void on_storm_mode(const int32_t *arg, char *tail) { (void)tail; cmd_storm_mode(arg[0]); }
+static void on_storm_hz(const int32_t *arg, char *tail) { (void)tail; cmd_storm_hz(arg[0]); }
+static void on_agg(const int32_t *arg, char *tail)     { (void)tail; cmd_agg(arg[0]); }
+static void on_proto(const int32_t *arg, char *tail)   { (void)tail; cmd_proto(arg[0] ? PROTO_BINARY : PROTO_ASCII); }
+static void on_ack(const int32_t *arg, char *tail)     { (void)tail; rel_on_ack(arg[0]); }
+static void on_rel(const int32_t *arg, char *tail)     { (void)tail; cmd_rel(arg[0]); }
+static void on_ping(const int32_t *arg, char *tail)    { (void)tail; cmd_ping(arg[0]); }
+static void on_ts(const int32_t *arg, char *tail)      { (void)tail; cmd_ts(arg[0]); }
+static void on_seed(const int32_t *arg, char *tail)    { (void)tail; cmd_seed(arg[0]); }
+#if PROFILE_ENABLE
+static void on_prof(const int32_t *arg, char *tail)    { (void)arg; (void)tail; cmd_prof(); }
+static void on_prof_reset(const int32_t *arg, char *tail) { (void)arg; (void)tail; cmd_prof_reset(); }
+#endif
+static void on_baud(const int32_t *arg, char *tail)    { (void)tail; cmd_baud(arg[0]); }
+static void on_baud_probe(const int32_t *arg, char *tail) { (void)arg; (void)tail; cmd_baud_probe(); }
+static void on_disp_hz(const int32_t *arg, char *tail) { (void)tail; cmd_disp_hz(arg[0]); }
+static void on_disp_dma(const int32_t *arg, char *tail) { (void)tail; cmd_disp_dma(arg[0]); }
+static void on_disp_bench(const int32_t *arg, char *tail) { (void)arg; (void)tail; cmd_disp_bench(); }
+static void on_status(const int32_t *arg, char *tail)  { (void)arg; (void)tail; cmd_status(); }
+
+// CMD:R:<seq>:<command> - a sequenced command of the reliable channel,
+// refused until CMD:REL:1 has reset the sequence numbers
+static void on_seq(const int32_t *arg, char *tail) {
+    if (!rel_enabled) {
+        log_to_buffer("ERR:R:OFF");
+        return;
+    }
+    if (rel_accept(arg[0])) {
+        dispatch_command(tail);
+    }
+}
+
+// Sorted by name: commands sharing a first letter must be adjacent
+static const CmdSpec cmd_table[] = {
+    { "ACK",          on_ack,          1, { INT_ARG(0, 65535) } },
+    { "AGG",          on_agg,          1, { INT_ARG(0, 1) } },
+    { "BAUD",         on_baud,         1, { INT_ARG(0, INT32_MAX) } },
+    { "BAUD_PROBE",   on_baud_probe,   0, { { 0 } } },
+    { "DISP_BENCH",   on_disp_bench,   0, { { 0 } } },
+    { "DISP_DMA",     on_disp_dma,     1, { INT_ARG(0, 1) } },
+    { "DISP_HZ",      on_disp_hz,      1, { INT_ARG(DISP_REFRESH_MIN_HZ, DISP_REFRESH_MAX_HZ) } },
+    { "PAUSE",        on_pause,        0, { { 0 } } },
+    { "PING",         on_ping,         1, { INT_ARG(0, INT32_MAX) } },
+#if PROFILE_ENABLE
+    { "PROF",         on_prof,         0, { { 0 } } },
+    { "PROF_RESET",   on_prof_reset,   0, { { 0 } } },
+#endif
+    { "PROTO",        on_proto,        1, { WORD_ARG(proto_words) } },
+    { "R",            on_seq,          2, { INT_ARG(0, 65535), TAIL_ARG } },
+    { "REL",          on_rel,          1, { INT_ARG(0, 1) } },
+    { "RESET",        on_reset,        0, { { 0 } } },
+    { "SEED",         on_seed,         1, { INT_ARG(0, INT32_MAX) } },
+    { "SHOT",         on_shot,         2, { INT_ARG(0, FIELD_WIDTH), INT_ARG(0, FIELD_HEIGHT) } },
+    { "START",        on_start,        0, { { 0 } } },
+    { "STATS",        on_stats,        0, { { 0 } } },
+    { "STATUS",       on_status,       0, { { 0 } } },
+    { "STORM_HZ",     on_storm_hz,     1, { INT_ARG(1, 50) } },
+    { "STORM_MODE",   on_storm_mode,   1, { WORD_ARG(storm_mode_words) } },
+    { "STORM_UPDATE", on_storm_update, 2, { INT_ARG(-10, 10), INT_ARG(-10, 10) } },
+    { "TS",           on_ts,           1, { INT_ARG(0, 1) } },
+};
+
+#define CMD_COUNT               (sizeof(cmd_table) / sizeof(cmd_table[0]))
+
+// cmd_table entries starting with letter L are cmd_bucket[L]..cmd_bucket[L + 1] - 1
+static uint8_t cmd_bucket[27];
+
+void commands_init(void) {
+    // An entry out of order would never be found: refuse to run with it
+    for (uint8_t n = 1; n < CMD_COUNT; n++) {
+        if (strcmp(cmd_table[n - 1].name, cmd_table[n].name) >= 0) {
+            log_to_buffer("ERR:CMD_TABLE:%s", cmd_table[n].name);
+            Error_Handler();
+        }
+    }
+
+    uint8_t i = 0;
+    for (uint8_t letter = 0; letter <= 26; letter++) {
+        while (i < CMD_COUNT && (uint8_t)(cmd_table[i].name[0] - 'A') < letter) i++;
+        cmd_bucket[letter] = i;
+    }
+}
+
+static const CmdSpec *cmd_lookup(const char *name, uint8_t len) {
+    uint8_t letter = (uint8_t)(name[0] - 'A');
+    if (len == 0 || letter >= 26) return NULL;
+    for (uint8_t i = cmd_bucket[letter]; i < cmd_bucket[letter + 1]; i++) {
+        const char *candidate = cmd_table[i].name;
+        if (strncmp(candidate, name, len) == 0 && candidate[len] == '\0') {
+            return &cmd_table[i];
+        }
+    }
+    return NULL;
+}
+
+// Parses up to the next ',' / ':' / end of line, which is left in *p
+static ArgError parse_int(char **p, int32_t min, int32_t max, int32_t *out) {
+    char *s = *p;
+    uint8_t negative = (*s == '-');
+    if (negative) s++;
+    if (*s < '0' || *s > '9') {
+        return (*s == '\0' || *s == ',' || *s == ':') && !negative ? ARG_ERR_MISSING : ARG_ERR_FORMAT;
+    }
+
+    int64_t value = 0;
+    while (*s >= '0' && *s <= '9') {
+        value = value * 10 + (*s++ - '0');
+        if (value > (int64_t)INT32_MAX + 1) return ARG_ERR_RANGE;
+    }
+    if (*s != '\0' && *s != ',' && *s != ':') return ARG_ERR_FORMAT;
+    if (negative) value = -value;
+    if (value < min || value > max) return ARG_ERR_RANGE;
+
+    *out = (int32_t)value;
+    *p = s;
+    return ARG_OK;
+}
+
+static ArgError parse_word(char **p, const char *const *words, int32_t *out) {
+    char *s = *p;
+    uint8_t len = 0;
+    while (s[len] != '\0' && s[len] != ',' && s[len] != ':') len++;
+    if (len == 0) return ARG_ERR_MISSING;
+
+    for (int32_t i = 0; words[i] != NULL; i++) {
+        if (strncmp(words[i], s, len) == 0 && words[i][len] == '\0') {
+            *out = i;
+            *p = s + len;
+            return ARG_OK;
+        }
+    }
+    return ARG_ERR_RANGE;
+}
+
+static void dispatch_command(char *line) {
+    char *p = line;
+    while (*p != '\0' && *p != ':') p++;
+
+    const CmdSpec *spec = cmd_lookup(line, (uint8_t)(p - line));
+    if (spec == NULL) {
+        log_to_buffer("COM: unknown cmd: CMD:%s", line);
+        return;
+    }
+
+    int32_t arg[CMD_MAX_ARGS] = {0};
+    char *tail = NULL;
+    for (uint8_t i = 0; i < spec->argc; i++) {
+        const ArgSpec *a = &spec->args[i];
+        ArgError err;
+        if (*p == '\0') {
+            err = ARG_ERR_MISSING;
+        } else if (a->kind == ARG_TAIL) {
+            tail = p + 1;
+            p = tail + strlen(tail);
+            err = (*tail == '\0') ? ARG_ERR_MISSING : ARG_OK;
+        } else {
+            p++;    // ':' before the first argument, ',' between them
+            err = (a->kind == ARG_WORD) ? parse_word(&p, a->words, &arg[i])
+                                        : parse_int(&p, a->min, a->max, &arg[i]);
+        }
+        if (err != ARG_OK) {
+            log_to_buffer("ERR:%s:%s:%d", spec->name, arg_error_names[err], i + 1);
+            return;
+        }
+    }
+    if (*p != '\0') {
+        log_to_buffer("ERR:%s:%s:%d", spec->name, arg_error_names[ARG_ERR_EXTRA], spec->argc + 1);
+        return;
+    }
+    spec->handler(arg, tail);
+}
+
+// Binary commands carry the same arguments as their text form and are held
+// to the same table ranges, with the same error reply
+static uint8_t check_binary_args(const char *name, const int32_t *arg) {
+    const CmdSpec *spec = cmd_lookup(name, (uint8_t)strlen(name));
+    for (uint8_t i = 0; i < spec->argc; i++) {
+        const ArgSpec *a = &spec->args[i];
+        if (a->kind == ARG_INT && (arg[i] < a->min || arg[i] > a->max)) {
+            log_to_buffer("ERR:%s:%s:%d", spec->name, arg_error_names[ARG_ERR_RANGE], i + 1);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void run_command(char *cmd) {
+    if (strncmp(cmd, "CMD:", 4) != 0) {
+        log_to_buffer("COM: unknown cmd: %s", cmd);
+        return;
+    }
+    dispatch_command(cmd + 4);
+}
+
+static void run_message(const uint8_t *msg, int n) {
+    int32_t arg[CMD_MAX_ARGS];
+    switch (msg[0]) {
+    case MSG_CMD_START: cmd_start(); break;
+    case MSG_CMD_PAUSE: cmd_pause(); break;
+    case MSG_CMD_RESET: cmd_reset(); break;
+    case MSG_CMD_SHOT:
+        if (n < 5) break;
+        arg[0] = get_le16(&msg[1]);
+        arg[1] = get_le16(&msg[3]);
+        if (check_binary_args("SHOT", arg)) cmd_shot(arg[0], arg[1]);
+        break;
+    case MSG_CMD_STORM_UPDATE:
+        if (n < 3) break;
+        arg[0] = (int8_t)msg[1];
+        arg[1] = (int8_t)msg[2];
+        if (check_binary_args("STORM_UPDATE", arg)) cmd_storm_update(arg[0], arg[1]);
+        break;
+    case MSG_CMD_PROTO:
+        if (n >= 2) cmd_proto(msg[1] ? PROTO_BINARY : PROTO_ASCII);
+        break;
+    case MSG_CMD_REL:
+        if (n < 4) break;
+        if (!rel_enabled) {
+            log_to_buffer("ERR:R:OFF");
+            break;
+        }
+        if (rel_accept(get_le16(&msg[1]))) run_message(msg + 3, n - 3);
+        break;
+    case MSG_CMD_ACK:
+        if (n >= 3) rel_on_ack(get_le16(&msg[1]));
+        break;
+    default:
+        log_to_buffer("COM: unknown msg: 0x%02X", msg[0]);
+        break;
+    }
+}
+
+void run_frame(const uint8_t *data, uint8_t len) {
+    uint8_t msg[CMD_LINE_SIZE];
+    int n = cobs_decode(data, len, msg, sizeof(msg));
+    if (n < 3 || crc16(msg, n - 2) != get_le16(&msg[n - 2])) {
+        rx_crc_error_count++;
+        return;
+    }
+    run_message(msg, n - 2);
+}
+
+void handle_commands(void) {
+    // Drain every line queued since the last pass, not just one
+    CmdSlot *slot;
+    while ((slot = rx_next_line()) != NULL) {
+        if (slot->is_frame) {
+            run_frame((const uint8_t*)slot->text, slot->len);
+        } else {
+            run_command(slot->text);
+        }
+        rx_line_done();
+    }
+    // One cumulative ACK for every sequenced command of this pass
+    if (rel_ack_pending) {
+        rel_send_ack();
+    }
+}
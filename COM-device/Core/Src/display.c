@@ -0,0 +1,259 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    display.c
+  * @brief   4-digit 7-segment display behind two shift registers, refreshed
+  *          one digit per TIM2 interrupt and shifted out by TIM3-paced DMA.
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+/* Includes ------------------------------------------------------------------*/
+#include "display.h"
+#include "tim.h"
+#include "game.h"
+#include "comm.h"
+#include <stdint.h>
+
+// Display: the main loop renders into disp_buf, the TIM2 interrupt shows
+// one digit of it per period
+volatile uint8_t disp_buf[DISP_DIGITS] = {0xFF, 0xFF, 0xFF, 0xFF};
+uint8_t disp_digit = 0;
+uint16_t disp_refresh_hz = DISP_REFRESH_HZ;
+// GPIOA BSRR word sequence per digit (SEG_DATA and SHIFT_CLOCK share the
+// port). TIM3 paces DMA1 channel 3 through it; the latch on PB5 is raised
+// when the transfer ends. Each digit has two buffers: the interrupt sends
+// the front one, the main loop rebuilds the back one when the digit
+// changes and then flips the index, so a transfer never sees a half-built
+// sequence.
+uint32_t disp_wave[DISP_DIGITS][2][DISP_WAVE_WORDS];
+volatile uint8_t disp_wave_front[DISP_DIGITS];
+uint8_t disp_wave_src[DISP_DIGITS];
+static const uint32_t *volatile disp_dma_wave = NULL;  // buffer the DMA is streaming
+uint8_t disp_dma_enabled = 1;
+uint32_t disp_direct_count = 0;
+uint8_t seg_nums[4] = {0xF8, 0xF4, 0xF2, 0xF1};
+uint8_t seg_digits[10] = {0xC0, 0xF9, 0xA4, 0xB0, 0x99, 0x92, 0x82, 0xF8, 0x80, 0x90};
+
+// Blinking while the game is paused
+volatile uint32_t last_blink_tick = 0;
+volatile uint8_t display_on = 1;
+
+// =============== DISPLAY ===============
+void writeByteToDisplay(uint8_t z) {
+    for (int i = 0; i < 8; ++i) {
+        HAL_GPIO_WritePin(SEG_DATA_GPIO_Port, SEG_DATA_Pin, ((z & 0x80) != 0) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+        HAL_GPIO_WritePin(SHIFT_CLOCK_GPIO_Port, SHIFT_CLOCK_Pin, GPIO_PIN_RESET);
+        HAL_GPIO_WritePin(SHIFT_CLOCK_GPIO_Port, SHIFT_CLOCK_Pin, GPIO_PIN_SET);
+        z <<= 1;
+    }
+}
+
+void writeSegmentToDisplay(uint8_t z, uint8_t val) {
+    HAL_GPIO_WritePin(SHIFT_LATCH_GPIO_Port, SHIFT_LATCH_Pin, GPIO_PIN_RESET);
+    writeByteToDisplay(val);
+    writeByteToDisplay(z);
+    HAL_GPIO_WritePin(SHIFT_LATCH_GPIO_Port, SHIFT_LATCH_Pin, GPIO_PIN_SET);
+}
+
+void displayInt(uint8_t value) {
+    if (value > 99) value = 99;
+    uint8_t tens = value / 10;
+    uint8_t ones = value % 10;
+    disp_buf[3] = 0xFF;
+    disp_buf[2] = 0xFF;
+    disp_buf[1] = seg_digits[tens];
+    disp_buf[0] = seg_digits[ones];
+}
+
+static uint32_t *disp_wave_byte(uint32_t *w, uint8_t z) {
+    for (int i = 0; i < 8; ++i) {
+        // Data and clock low in one write, then the rising clock edge
+        *w++ = ((z & 0x80) ? SEG_DATA_Pin : ((uint32_t)SEG_DATA_Pin << 16)) |
+               ((uint32_t)SHIFT_CLOCK_Pin << 16);
+        *w++ = SHIFT_CLOCK_Pin;
+        z <<= 1;
+    }
+    return w;
+}
+
+// Same bit order as writeSegmentToDisplay(): segments first, then digit select.
+// A back buffer still streaming from just before the last flip is left
+// alone; disp_wave_src stays stale, so the next pass tries again.
+static void disp_wave_build(uint8_t digit) {
+    uint8_t back = disp_wave_front[digit] ^ 1;
+    uint32_t *wave = disp_wave[digit][back];
+    if (wave == disp_dma_wave) return;
+
+    uint8_t val = disp_buf[digit];
+    disp_wave_byte(disp_wave_byte(wave, val), seg_nums[digit]);
+    // A byte store: the interrupt sees either the old sequence or the new one
+    disp_wave_front[digit] = back;
+    disp_wave_src[digit] = val;
+}
+
+// Renders the current state into disp_buf; nothing is written to the pins here
+void updateDisplay(void) {
+    if (!display_on) {
+        for (int i = 0; i < DISP_DIGITS; i++) {
+            disp_buf[i] = 0xFF;
+        }
+    } else {
+        displayInt(game_time);
+    }
+    for (uint8_t i = 0; i < DISP_DIGITS; i++) {
+        if (disp_wave_src[i] != disp_buf[i]) disp_wave_build(i);
+    }
+}
+
+void display_blink(uint32_t current_time) {
+    if (game_started && game_paused) {
+        if (current_time - last_blink_tick >= DISP_BLINK_MS) {
+            last_blink_tick = current_time;
+            display_on = !display_on;
+        }
+    } else {
+        display_on = 1;
+    }
+}
+
+// TIM2 clock after the prescaler: APB1 timers run at twice PCLK1 when it is divided
+static uint32_t disp_timer_clock(void) {
+    uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) {
+        pclk1 *= 2;
+    }
+    return pclk1 / (htim2.Init.Prescaler + 1);
+}
+
+// Takes effect from the next update event, TIM2 runs with ARR preload
+void display_set_refresh(uint16_t hz) {
+    disp_refresh_hz = hz;
+    __HAL_TIM_SET_AUTORELOAD(&htim2, disp_timer_clock() / ((uint32_t)hz * DISP_DIGITS) - 1);
+}
+
+static void disp_latch(void) {
+    SHIFT_LATCH_GPIO_Port->BSRR = SHIFT_LATCH_Pin;
+}
+
+static void disp_dma_done(DMA_HandleTypeDef *hdma) {
+    (void)hdma;
+    __HAL_TIM_DISABLE(&htim3);
+    disp_dma_wave = NULL;
+    disp_latch();
+}
+
+// CPU path over the same words; the loop overhead keeps the clock pulses
+// well above the shift register's minimum width
+static void disp_send_direct(const uint32_t *wave) {
+    for (int i = 0; i < DISP_WAVE_WORDS; i++) {
+        SEG_DATA_GPIO_Port->BSRR = wave[i];
+    }
+    disp_latch();
+}
+
+// Latch goes low, then the digit is shifted out by DMA, or by the CPU when
+// the channel is unavailable. The outputs keep the previous digit meanwhile.
+static void disp_send(const uint32_t *wave) {
+    SHIFT_LATCH_GPIO_Port->BSRR = (uint32_t)SHIFT_LATCH_Pin << 16;
+    if (disp_dma_enabled) {
+        __HAL_TIM_SET_COUNTER(&htim3, 0);
+        if (HAL_DMA_Start_IT(&hdma_tim3_up, (uint32_t)(uintptr_t)wave,
+                             (uint32_t)(uintptr_t)&SEG_DATA_GPIO_Port->BSRR, DISP_WAVE_WORDS) == HAL_OK) {
+            disp_dma_wave = wave;
+            __HAL_TIM_ENABLE(&htim3);
+            return;
+        }
+        // Previous digit still shifting: stop it so only one writer drives the pins
+        __HAL_TIM_DISABLE(&htim3);
+        HAL_DMA_Abort(&hdma_tim3_up);
+        disp_dma_wave = NULL;
+    }
+    disp_direct_count++;
+    disp_send_direct(wave);
+}
+
+void display_start(void) {
+    for (uint8_t i = 0; i < DISP_DIGITS; i++) {
+        disp_wave_build(i);
+    }
+    MX_TIM3_DisplayDMA_Init(DISP_DMA_WORD_HZ);
+    hdma_tim3_up.XferCpltCallback = disp_dma_done;
+    hdma_tim3_up.XferErrorCallback = disp_dma_done;
+    display_set_refresh(disp_refresh_hz);
+    HAL_TIM_Base_Start_IT(&htim2);
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+    if (htim->Instance == TIM2) {
+        disp_send(disp_wave[disp_digit][disp_wave_front[disp_digit]]);
+        disp_digit = (disp_digit + 1) % DISP_DIGITS;
+    }
+}
+
+void dwt_init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+// 0 if the display DMA is still busy after DISP_BENCH_TIMEOUT_MS
+static uint8_t disp_dma_wait_idle(void) {
+    uint32_t start = HAL_GetTick();
+    while (hdma_tim3_up.State != HAL_DMA_STATE_READY) {
+        if (HAL_GetTick() - start >= DISP_BENCH_TIMEOUT_MS) return 0;
+    }
+    return 1;
+}
+
+// CPU cycles to put one digit out: the original HAL bit-banging, direct BSRR
+// writes of the precomputed words, and starting the DMA transfer. Returns 0
+// if the DMA channel never went idle.
+uint8_t display_bench(uint32_t *hal, uint32_t *bsrr, uint32_t *dma) {
+    const uint32_t *wave = disp_wave[0][disp_wave_front[0]];
+    HAL_NVIC_DisableIRQ(TIM2_IRQn);
+    if (!disp_dma_wait_idle()) {
+        HAL_NVIC_EnableIRQ(TIM2_IRQn);
+        return 0;
+    }
+    dwt_init();
+
+    uint32_t start = DWT->CYCCNT;
+    writeSegmentToDisplay(seg_nums[0], disp_buf[0]);
+    *hal = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    SHIFT_LATCH_GPIO_Port->BSRR = (uint32_t)SHIFT_LATCH_Pin << 16;
+    disp_send_direct(wave);
+    *bsrr = DWT->CYCCNT - start;
+
+    uint8_t dma_enabled = disp_dma_enabled;
+    disp_dma_enabled = 1;
+    start = DWT->CYCCNT;
+    disp_send(wave);
+    *dma = DWT->CYCCNT - start;
+    disp_dma_enabled = dma_enabled;
+    uint8_t ok = disp_dma_wait_idle();
+
+    HAL_NVIC_EnableIRQ(TIM2_IRQn);
+    return ok;
+}
+
+// =============== COMMANDS ===============
+void cmd_disp_hz(uint16_t hz) {
+    display_set_refresh(hz);
+    log_to_buffer("DISP_HZ:%u", disp_refresh_hz);
+}
+
+void cmd_disp_dma(uint8_t enable) {
+    disp_dma_enabled = enable ? 1 : 0;
+    log_to_buffer("DISP_DMA:%d,%lu", disp_dma_enabled, (unsigned long)disp_direct_count);
+}
+
+void cmd_disp_bench(void) {
+    uint32_t hal, bsrr, dma;
+    if (!display_bench(&hal, &bsrr, &dma)) {
+        log_to_buffer("ERR:DISP_BENCH:TIMEOUT");
+        return;
+    }
+    log_to_buffer("DISP_BENCH:HAL:%lu,BSRR:%lu,DMA:%lu", (unsigned long)hal,
+                  (unsigned long)bsrr, (unsigned long)dma);
+}
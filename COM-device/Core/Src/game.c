@@ -0,0 +1,383 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    game.c
+  * @brief   Game rules: ships, shots, the storm, the crosshair and the
+  *          game clock. No peripheral access, so it builds for the host too.
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+/* Includes ------------------------------------------------------------------*/
+#include "game.h"
+#include "comm.h"
+#include <stdio.h>
+
+// Buttons: presses go from the EXTI interrupts into btn_fifo through
+// button_push(), process_buttons() drains it. All EXTI lines share one
+// priority, so they never preempt each other and act as a single producer.
+ButtonEvent btn_fifo[BTN_FIFO_SIZE];
+volatile uint8_t btn_head = 0;
+volatile uint8_t btn_tail = 0;
+uint32_t btn_overflow_count = 0;
+
+// Game state
+volatile uint8_t game_started = 0;
+volatile uint8_t game_paused = 0;
+volatile uint8_t game_time = 60;
+volatile uint32_t last_second_tick = 0;
+volatile uint32_t last_ship_spawn = 0;
+
+// Crosshair state
+uint32_t crosshair_locked = 0;
+uint32_t crosshair_x = 400;
+uint32_t crosshair_y = 300;
+uint32_t vertical_direction = 1;
+
+// Ships: free slots are set bits in ship_free_map, and ship_free_summary
+// has a bit per map word that still has one. Live slots are kept densely
+// in ship_list so every walk costs only as much as the ships on the field.
+Ship ships[MAX_SHIPS] = {0};
+ship_idx_t ship_list[MAX_SHIPS];
+uint32_t ship_count = 0;
+uint32_t ship_free_map[SHIP_MAP_WORDS];
+uint32_t ship_free_summary = 0;
+// Uniform grid over the field, one intrusive list of slots per cell
+uint16_t ship_grid[GRID_ROWS * GRID_COLS];
+// Hit radius squared by type / 10
+static const uint16_t ship_radius_sq[4] = { 0, 25 * 25, 35 * 35, 45 * 45 };
+
+// Random numbers: every START reseeds, so a session is replayed by
+// sending CMD:SEED with the seed echoed in its START line
+Pcg32 rng;
+uint32_t rng_seed = 0;          // seed of the current session
+uint8_t rng_seed_pinned = 0;    // CMD:SEED chose the seed for the next START
+
+// Storm
+volatile uint32_t last_storm_update = 0;
+volatile uint32_t storm_update_interval_ms = 100;   // CMD:STORM_HZ
+StormParams storm = {
+    .amp_x = 25,
+    .amp_y = 12,
+    .period_x_ms = 2400,
+    .period_y_ms = 1900,
+    .phase_y_mrad = 700,
+};
+// Parametric storm sync: the browser evaluates the waveform itself
+volatile uint8_t storm_param_mode = 0;
+volatile uint32_t last_storm_sync = 0;
+// Storm activation logic
+volatile uint8_t storm_active = 1;
+
+// =============== RANDOM NUMBERS ===============
+uint32_t rng_next(void) {
+    uint64_t old = rng.state;
+    rng.state = old * 6364136223846793005ULL + rng.inc;
+    uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+}
+
+// 0..n-1 by multiply-shift; the bias is below n / 2^32
+uint32_t rng_below(uint32_t n) {
+    return (uint32_t)(((uint64_t)rng_next() * n) >> 32);
+}
+
+void rng_set_seed(uint32_t seed) {
+    rng.state = 0;
+    rng.inc = ((uint64_t)seed << 1) | 1u;
+    rng_next();
+    rng.state += seed;
+    rng_next();
+}
+
+// =============== SHIP POOL ===============
+static inline uint32_t ctz32(uint32_t v) {
+    return __CLZ(__RBIT(v));
+}
+
+void ship_pool_reset(void) {
+    for (uint32_t w = 0; w < SHIP_MAP_WORDS; w++) {
+        uint32_t left = MAX_SHIPS - w * 32;
+        ship_free_map[w] = (left >= 32) ? 0xFFFFFFFFu : ((1u << left) - 1);
+    }
+    ship_free_summary = (SHIP_MAP_WORDS == 32) ? 0xFFFFFFFFu : ((1u << SHIP_MAP_WORDS) - 1);
+    ship_count = 0;
+    for (uint32_t c = 0; c < GRID_ROWS * GRID_COLS; c++) ship_grid[c] = GRID_NONE;
+}
+
+// Lowest free slot, or -1 when the pool is full
+int ship_alloc(void) {
+    if (!ship_free_summary) return -1;
+    uint32_t w = ctz32(ship_free_summary);
+    uint32_t b = ctz32(ship_free_map[w]);
+    ship_free_map[w] &= ~(1u << b);
+    if (!ship_free_map[w]) ship_free_summary &= ~(1u << w);
+
+    uint32_t slot = w * 32 + b;
+    ships[slot].pos = (ship_idx_t)ship_count;
+    ship_list[ship_count++] = (ship_idx_t)slot;
+    return (int)slot;
+}
+
+// The last listed ship moves into the freed place in ship_list
+void ship_free(uint32_t slot) {
+    ship_idx_t last = ship_list[--ship_count];
+    ship_list[ships[slot].pos] = last;
+    ships[last].pos = ships[slot].pos;
+
+    ship_free_map[slot / 32] |= 1u << (slot % 32);
+    ship_free_summary |= 1u << (slot / 32);
+}
+
+static inline uint32_t grid_cell(uint16_t x, uint16_t y) {
+    return (y / GRID_CELL) * GRID_COLS + x / GRID_CELL;
+}
+
+void grid_insert(uint32_t slot) {
+    uint32_t c = grid_cell(ships[slot].x, ships[slot].y);
+    ships[slot].next = ship_grid[c];
+    ship_grid[c] = (uint16_t)slot;
+}
+
+// Cells hold a handful of ships at most, so unlinking just walks the cell
+void grid_remove(uint32_t slot) {
+    uint16_t *link = &ship_grid[grid_cell(ships[slot].x, ships[slot].y)];
+    while (*link != slot) link = &ships[*link].next;
+    *link = ships[slot].next;
+}
+
+// =============== GAME LOGIC ===============
+void spawn_ship(void) {
+    int free_slot = ship_alloc();
+    if (free_slot == -1) return;
+
+    uint8_t type;
+    uint32_t r = rng_below(100);
+    if (r < 50) type = 10;
+    else if (r < 80) type = 20;
+    else type = 30;
+
+    uint16_t x = MIN_X + rng_below(MAX_X - MIN_X + 1);
+    uint16_t y = MIN_Y + rng_below(MAX_Y - MIN_Y + 1);
+
+    ships[free_slot].type = type;
+    ships[free_slot].x = x;
+    ships[free_slot].y = y;
+    grid_insert(free_slot);
+
+    emit_event(EV_SHIP, type, x, y);
+}
+
+// Only the 3x3 cells around the shot can hold a ship in range; of those
+// in range, the one closest to the crosshair is hit
+void check_ship_hit(uint16_t ch_x, uint16_t ch_y) {
+    int hit_index = -1;
+    int best_sq = 0;
+
+    if (ch_x > FIELD_WIDTH) ch_x = FIELD_WIDTH;
+    if (ch_y > FIELD_HEIGHT) ch_y = FIELD_HEIGHT;
+    uint32_t col = ch_x / GRID_CELL;
+    uint32_t row = ch_y / GRID_CELL;
+    uint32_t col_lo = col ? col - 1 : 0;
+    uint32_t row_lo = row ? row - 1 : 0;
+    uint32_t col_hi = (col + 1 < GRID_COLS) ? col + 1 : GRID_COLS - 1;
+    uint32_t row_hi = (row + 1 < GRID_ROWS) ? row + 1 : GRID_ROWS - 1;
+
+    for (uint32_t r = row_lo; r <= row_hi; r++) {
+        for (uint32_t c = col_lo; c <= col_hi; c++) {
+            for (uint16_t i = ship_grid[r * GRID_COLS + c]; i != GRID_NONE; i = ships[i].next) {
+                int dx = ch_x - ships[i].x;
+                int dy = ch_y - ships[i].y;
+                int dist_sq = dx * dx + dy * dy;
+                if (dist_sq <= ship_radius_sq[ships[i].type / 10] &&
+                    (hit_index < 0 || dist_sq < best_sq)) {
+                    hit_index = i;
+                    best_sq = dist_sq;
+                }
+            }
+        }
+    }
+    if (hit_index >= 0) {
+        uint8_t hit_type = ships[hit_index].type;
+        uint16_t hit_x = ships[hit_index].x;
+        uint16_t hit_y = ships[hit_index].y;
+        grid_remove(hit_index);
+        ship_free(hit_index);
+        emit_event(EV_HIT, hit_type, hit_x, hit_y);
+    } else {
+        emit_event(EV_MISS, 0, ch_x, ch_y);
+    }
+}
+
+void get_storm_offsets(int16_t* out_x, int16_t* out_y) {
+    storm_offsets(&storm, HAL_GetTick(), out_x, out_y);
+}
+
+void update_game_logic(uint32_t current_time) {
+    if (!game_started || game_paused) return;
+
+    // Spawn ships every 2 seconds
+    if (current_time - last_ship_spawn >= 4000) {
+        last_ship_spawn = current_time;
+        spawn_ship();
+    }
+
+    // Timer tick every second
+    if (current_time - last_second_tick >= 1000) {
+        last_second_tick = current_time;
+        if (game_time > 0) {
+            game_time--;
+            emit_event(EV_TIME, game_time, 0, 0);
+            if (game_time == 0) {
+								game_started = 0;
+            }
+        }
+    }
+		
+		// Storm logic
+    if (storm_param_mode) {
+        // Samples are not streamed, only the clock reference for the browser
+        if (current_time - last_storm_sync >= STORM_SYNC_INTERVAL_MS) {
+            last_storm_sync = current_time;
+            send_storm_sync();
+        }
+    } else if (current_time - last_storm_update >= storm_update_interval_ms) {
+        last_storm_update = current_time;
+        int16_t sx, sy;
+        get_storm_offsets(&sx, &sy);
+        emit_event(EV_STORM, 0, sx, sy);
+    }
+}
+
+// =============== BUTTONS ===============
+// Called from the EXTI interrupt with the time of the press
+void button_push(uint8_t button, uint32_t tick) {
+    uint8_t next = (btn_head + 1) & (BTN_FIFO_SIZE - 1);
+    if (next == btn_tail) {
+        btn_overflow_count++;
+        return;
+    }
+    btn_fifo[btn_head].button = button;
+    btn_fifo[btn_head].tick = tick;
+    btn_head = next;
+    loop_event[EVT_BUTTON] = 1;
+}
+
+void process_buttons(void) {
+    while (btn_tail != btn_head) {
+        ButtonEvent ev = btn_fifo[btn_tail];
+        btn_tail = (btn_tail + 1) & (BTN_FIFO_SIZE - 1);
+        if (!game_started || game_paused) continue;
+
+        char ts[12] = "";
+        if (ts_enabled) {
+            snprintf(ts, sizeof(ts), "@%lu", (unsigned long)ev.tick);
+        }
+
+        switch (ev.button) {
+        case BTN_LEFT:
+            if (crosshair_x > MIN_X) {
+                crosshair_x -= CROSSHAIR_STEP_X;
+            }
+            log_to_buffer("CROSSHAIR_STEP_LEFT%s", ts);
+            break;
+        case BTN_RIGHT:
+            if (crosshair_x < MAX_X) {
+                crosshair_x += CROSSHAIR_STEP_X;
+            }
+            log_to_buffer("CROSSHAIR_STEP_RIGHT%s", ts);
+            break;
+        case BTN_MIDDLE:
+            crosshair_locked = !crosshair_locked;
+            log_to_buffer("MIDDLE_CLICK:%lu,%lu%s", (unsigned long)crosshair_x, (unsigned long)crosshair_y, ts);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// =============== COMMANDS ===============
+void cmd_start(void) {
+    game_started = 1;
+    game_paused = 0;
+    crosshair_locked = 0;
+    crosshair_x = 400;
+    crosshair_y = 300;
+    vertical_direction = 1;
+    ship_pool_reset();
+    if (!rng_seed_pinned) rng_seed = rng_entropy();
+    rng_seed_pinned = 0;
+    rng_set_seed(rng_seed);
+    last_ship_spawn = HAL_GetTick();
+    last_second_tick = HAL_GetTick();
+    log_to_buffer("COM: START=%d, PAUSE=%d, SEED=%lu", game_started, game_paused,
+                  (unsigned long)rng_seed);
+    emit_event(EV_TIME, game_time, 0, 0);
+}
+
+void cmd_pause(void) {
+    game_started = 1;
+    game_paused = !game_paused;
+    if (!game_paused) {
+        last_second_tick = HAL_GetTick();
+    }
+    log_to_buffer("COM: START=%d, PAUSE=%d", game_started, game_paused);
+}
+
+void cmd_reset(void) {
+    game_started = 0;
+    game_paused = 0;
+    game_time = 60;
+    crosshair_locked = 0;
+    crosshair_x = 400;
+    crosshair_y = 300;
+    ship_pool_reset();
+    log_to_buffer("COM: reset=1");
+    emit_event(EV_TIME, game_time, 0, 0);
+}
+
+void cmd_shot(uint16_t x, uint16_t y) {
+    check_ship_hit(x, y);
+    crosshair_locked = 0;
+}
+
+// Applies to the next START only
+void cmd_seed(uint32_t seed) {
+    rng_seed = seed;
+    rng_seed_pinned = 1;
+    log_to_buffer("SEED:%lu", (unsigned long)seed);
+}
+
+void cmd_storm_update(int16_t delta_x, int16_t delta_y) {
+    int16_t new_x = storm.amp_x + delta_x * 5;
+    int16_t new_y = storm.amp_y + delta_y * 5;
+
+    if (new_x < 0) new_x = 0;
+    if (new_x > 50) new_x = 50;
+    if (new_y < 0) new_y = 0;
+    if (new_y > 50) new_y = 50;
+
+    storm.amp_x = new_x;
+    storm.amp_y = new_y;
+
+    log_to_buffer("STORM_AMP_UPDATED:%d,%d", new_x, new_y);
+    if (storm_param_mode) {
+        send_storm_param();
+    }
+}
+
+void cmd_storm_mode(uint8_t parametric) {
+    storm_param_mode = parametric ? 1 : 0;
+    log_to_buffer("STORM_MODE:%s", storm_param_mode ? "PARAM" : "SAMPLE");
+    if (storm_param_mode) {
+        last_storm_sync = HAL_GetTick();
+        send_storm_param();
+    }
+}
+
+// Sampled mode only: samples are cheap now, the UART is the limit
+void cmd_storm_hz(uint16_t hz) {
+    storm_update_interval_ms = 1000 / hz;
+    log_to_buffer("STORM_HZ:%u", hz);
+}
@@ -51,13 +51,13 @@ void MX_GPIO_Init(void)
 
   /*Configure GPIO pins : LEFT_BUTTON_Pin MIDDLE_BUTTON_Pin */
   GPIO_InitStruct.Pin = LEFT_BUTTON_Pin|MIDDLE_BUTTON_Pin;
-  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
   GPIO_InitStruct.Pull = GPIO_NOPULL;
   HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
   /*Configure GPIO pin : RIGHT_BUTTON_Pin */
   GPIO_InitStruct.Pin = RIGHT_BUTTON_Pin;
-  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
   GPIO_InitStruct.Pull = GPIO_NOPULL;
   HAL_GPIO_Init(RIGHT_BUTTON_GPIO_Port, &GPIO_InitStruct);
 
@@ -13,14 +13,15 @@
 #include "tim.h"
 #include "usart.h"
 #include "gpio.h"
-#include "math.h"
 #include "string.h"
-#include <stdarg.h>
 #include <stdio.h>
-#include <stdlib.h>
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "app.h"
+#include "comm.h"
+#include "game.h"
+#include "display.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -29,27 +30,18 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-#define DEBOUNCE_DELAY          20
-#define CMD_LINE_SIZE           32
-#define MAX_SHIPS               25
-#define FIELD_WIDTH             800
-#define FIELD_HEIGHT            600
-#define RX_BUFFER_SIZE          32
-
-// Crosshair movement
-#define CROSSHAIR_STEP_X        25
-#define CROSSHAIR_STEP_Y        3
-#define MIN_X                   40
-#define MAX_X                   (FIELD_WIDTH - 40)
-#define MIN_Y                   40
-#define MAX_Y                   (FIELD_HEIGHT - 40)
+#define DEBOUNCE_DELAY          20      // ms a button must read released before it re-arms
+#define PROF_BINS               20      // bin k counts [2^k, 2^(k+1)) cycles, the last is open
 
+#if PROFILE_ENABLE
 typedef struct {
-    uint8_t active;
-    uint8_t type;
-    uint16_t x;
-    uint16_t y;
-} Ship;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t hist[PROF_BINS];
+} ProfStat;
+#endif
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -58,391 +50,245 @@ typedef struct {
 
 /* Private variables ---------------------------------------------------------*/
 /* USER CODE BEGIN PV */
-// UART DMA
-extern DMA_HandleTypeDef hdma_usart2_rx;
-extern DMA_HandleTypeDef hdma_usart2_tx;
-uint8_t rx_dma_buffer[RX_BUFFER_SIZE] = {0};
-char cmd_line[CMD_LINE_SIZE] = {0};
-uint8_t cmd_ready = 0;
-
-// UART TX control
-volatile uint8_t uart_tx_busy = 0;
-
-// Display
-uint8_t disp_buf[4] = {0xFF, 0xFF, 0xFF, 0xFF};
-uint8_t seg_nums[4] = {0xF8, 0xF4, 0xF2, 0xF1};
-uint8_t seg_digits[10] = {0xC0, 0xF9, 0xA4, 0xB0, 0x99, 0x92, 0x82, 0xF8, 0x80, 0x90};
-
-// Logging
-volatile uint8_t logging_enabled = 1;
-
-// Buttons
-volatile uint8_t left_button_prev = 1;
-volatile uint8_t right_button_prev = 1;
-volatile uint8_t middle_button_prev = 1;
-
-// Game state
-volatile uint8_t game_started = 0;
-volatile uint8_t game_paused = 0;
-volatile uint8_t game_time = 60;
-volatile uint32_t last_second_tick = 0;
-volatile uint32_t last_blink_tick = 0;
-volatile uint8_t display_on = 1;
-volatile uint32_t last_ship_spawn = 0;
-
-// Crosshair state
-uint32_t crosshair_locked = 0;
-uint32_t crosshair_x = 400;
-uint32_t crosshair_y = 300;
-uint32_t vertical_direction = 1;
-
-// Ships
-Ship ships[MAX_SHIPS] = {0};
-
-// Storm
-volatile uint32_t last_storm_update = 0;
-const uint32_t STORM_UPDATE_INTERVAL_MS = 100; 
-volatile float storm_amplitude_x = 25.0f;      
-volatile float storm_amplitude_y = 12.0f; 
-const float STORM_PERIOD_X_MS = 2400.0f;
-const float STORM_PERIOD_Y_MS = 1900.0f;  
-// Storm activation logic
-volatile uint8_t storm_active = 1;
+// Event-driven main loop: interrupts set loop_event[], main() runs the
+// stages with work and sleeps in WFI otherwise
+volatile uint8_t loop_event[EVT_COUNT] = {0, 0, 0, 1};
+volatile uint32_t loop_deadline = 0;
+// 64-bit: a 32-bit microsecond count wraps after 71.6 minutes between STATUS reads
+uint64_t loop_idle_us = 0;
+uint32_t loop_wakeups = 0;
+uint32_t loop_stats_since = 0;      // HAL_GetTick() at the previous STATUS
+#if PROFILE_ENABLE
+ProfStat prof[PROF_STAGE_COUNT];
+uint32_t prof_t0 = 0;
+uint32_t prof_loop_at = 0;
+volatile uint32_t prof_wake_at = 0;
+volatile uint8_t prof_wake_valid = 0;
+static const char *const prof_names[PROF_STAGE_COUNT] = {
+    "RX", "SERVICE", "BUTTONS", "GAME", "FLUSH", "DISPLAY", "LOOP", "WAKE"
+};
+#endif
+
+// Buttons: the EXTI lines and their debounce state
+static GPIO_TypeDef *const button_port[BTN_COUNT] = {
+    LEFT_BUTTON_GPIO_Port, RIGHT_BUTTON_GPIO_Port, MIDDLE_BUTTON_GPIO_Port
+};
+static const uint16_t button_pin[BTN_COUNT] = {
+    LEFT_BUTTON_Pin, RIGHT_BUTTON_Pin, MIDDLE_BUTTON_Pin
+};
+// A line stays masked after a press until the button has read released
+// for DEBOUNCE_DELAY; SysTick re-arms it
+volatile uint8_t button_masked[BTN_COUNT] = {0};
+uint32_t button_release_at[BTN_COUNT] = {0};
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 /* USER CODE BEGIN PFP */
+void buttons_debounce_tick(uint32_t now);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
 
-// =============== UART / LOGGING ===============
-void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
-    if (huart->Instance == USART2) {
-        uart_tx_busy = 0;
-    }
-}
-
-uint8_t is_uart_tx_ready(void) {
-    return (__HAL_DMA_GET_COUNTER(&hdma_usart2_tx) == 0);
-}
-
-void log_to_buffer(const char* format, ...) {
-    if (!logging_enabled) return;
-    static char tx_buffer[128];
-    if (uart_tx_busy) return;
-
-    va_list args;
-    va_start(args, format);
-    int len = vsnprintf(tx_buffer, sizeof(tx_buffer) - 2, format, args);
-    va_end(args);
-    if (len <= 0) return;
-
-    tx_buffer[len] = '\r';
-    tx_buffer[len + 1] = '\n';
-    len += 2;
-
-    uart_tx_busy = 1;
-    HAL_UART_Transmit_DMA(&huart2, (uint8_t*)tx_buffer, len);
+// =============== MAIN LOOP EVENTS ===============
+// A flag is cleared before its stage runs, so an interrupt arriving while
+// the stage runs is seen on the next pass rather than lost
+static uint8_t event_take(LoopEvent ev) {
+    if (!loop_event[ev]) return 0;
+    loop_event[ev] = 0;
+    return 1;
 }
 
-// =============== DISPLAY ===============
-void writeByteToDisplay(uint8_t z) {
-    for (int i = 0; i < 8; ++i) {
-        HAL_GPIO_WritePin(SEG_DATA_GPIO_Port, SEG_DATA_Pin, ((z & 0x80) != 0) ? GPIO_PIN_SET : GPIO_PIN_RESET);
-        HAL_GPIO_WritePin(SHIFT_CLOCK_GPIO_Port, SHIFT_CLOCK_Pin, GPIO_PIN_RESET);
-        HAL_GPIO_WritePin(SHIFT_CLOCK_GPIO_Port, SHIFT_CLOCK_Pin, GPIO_PIN_SET);
-        z <<= 1;
+static uint8_t events_pending(void) {
+    for (int i = 0; i < EVT_COUNT; i++) {
+        if (loop_event[i]) return 1;
     }
+    return 0;
 }
 
-void writeSegmentToDisplay(uint8_t z, uint8_t val) {
-    HAL_GPIO_WritePin(SHIFT_LATCH_GPIO_Port, SHIFT_LATCH_Pin, GPIO_PIN_RESET);
-    writeByteToDisplay(val);
-    writeByteToDisplay(z);
-    HAL_GPIO_WritePin(SHIFT_LATCH_GPIO_Port, SHIFT_LATCH_Pin, GPIO_PIN_SET);
+// Called from SysTick_Handler every millisecond
+void loop_systick(void) {
+    uint32_t now = HAL_GetTick();
+    if ((int32_t)(now - loop_deadline) >= 0) {
+#if PROFILE_ENABLE
+        if (!loop_event[EVT_TIMER]) {
+            prof_wake_at = DWT->CYCCNT;
+            prof_wake_valid = 1;
+        }
+#endif
+        loop_event[EVT_TIMER] = 1;
+    }
+    buttons_debounce_tick(now);
 }
 
-void displayInt(uint8_t value) {
-    if (value > 99) value = 99;
-    uint8_t tens = value / 10;
-    uint8_t ones = value % 10;
-    disp_buf[3] = 0xFF;
-    disp_buf[2] = 0xFF;
-    disp_buf[1] = seg_digits[tens];
-    disp_buf[0] = seg_digits[ones];
+// Microseconds from the millisecond tick and the SysTick down-counter, for
+// short intervals only: the value wraps every 71.6 minutes.
+// Interrupts must be off; a pending SysTick means the tick is one behind.
+static uint32_t loop_time_us(void) {
+    uint32_t ms = HAL_GetTick();
+    uint32_t val = SysTick->VAL;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+        ms++;
+        val = SysTick->VAL;
+    }
+    return ms * 1000 + (SysTick->LOAD - val) * 1000 / (SysTick->LOAD + 1);
 }
 
-void updateDisplay(void) {
-    if (!display_on) {
-        for (int i = 0; i < 4; i++) {
-            writeSegmentToDisplay(seg_nums[i], 0xFF);
-        }
-        return;
+// Sleeps until an interrupt raises a loop event. Checking and sleeping with
+// interrupts masked closes the window in which a wake-up could slip in
+// between; WFI still returns on a masked interrupt, which then runs once
+// PRIMASK is cleared. Interrupts without a loop event (TIM2 display, SysTick
+// before the deadline) go straight back to sleep.
+static void loop_sleep(uint32_t deadline) {
+    loop_deadline = deadline;
+    __disable_irq();
+    if ((int32_t)(HAL_GetTick() - deadline) >= 0) {
+        loop_event[EVT_TIMER] = 1;
     }
-    displayInt(game_time);
-    for (int i = 0; i < 4; i++) {
-        writeSegmentToDisplay(seg_nums[i], disp_buf[i]);
+    while (!events_pending()) {
+        uint32_t start = loop_time_us();
+        __WFI();
+        loop_idle_us += loop_time_us() - start;
+        loop_wakeups++;
+        __enable_irq();
+        __disable_irq();
     }
+    __enable_irq();
 }
 
-// =============== GAME LOGIC ===============
-uint32_t get_random(void) {
-    return HAL_GetTick() ^ (HAL_GetTick() << 5) ^ (HAL_GetTick() >> 3);
+#if PROFILE_ENABLE
+// =============== PROFILING ===============
+void prof_record(ProfStage stage, uint32_t cycles) {
+    ProfStat *p = &prof[stage];
+    if (cycles < p->min) p->min = cycles;
+    if (cycles > p->max) p->max = cycles;
+    p->sum += cycles;
+    p->count++;
+    uint32_t bin = cycles ? 31 - __CLZ(cycles) : 0;
+    p->hist[bin < PROF_BINS ? bin : PROF_BINS - 1]++;
 }
 
-void spawn_ship(void) {
-    int free_slot = -1;
-    for (int i = 0; i < MAX_SHIPS; i++) {
-        if (!ships[i].active) {
-            free_slot = i;
-            break;
-        }
-    }
-    if (free_slot == -1) return;
-
-    uint8_t type;
-    uint32_t r = get_random() % 100;
-    if (r < 50) type = 10;
-    else if (r < 80) type = 20;
-    else type = 30;
-
-    uint16_t x = MIN_X + (get_random() % (MAX_X - MIN_X + 1));
-    uint16_t y = MIN_Y + (get_random() % (MAX_Y - MIN_Y + 1));
-
-    ships[free_slot].active = 1;
-    ships[free_slot].type = type;
-    ships[free_slot].x = x;
-    ships[free_slot].y = y;
-
-    log_to_buffer("SHIP:%d,%d,%d", type, x, y);
+void prof_reset(void) {
+    memset(prof, 0, sizeof(prof));
+    for (int i = 0; i < PROF_STAGE_COUNT; i++) prof[i].min = UINT32_MAX;
+    prof_loop_at = DWT->CYCCNT;
+    prof_wake_valid = 0;
 }
 
-void check_ship_hit(uint16_t ch_x, uint16_t ch_y) {
-    int hit = 0;
-    uint8_t hit_type = 0;
-    int hit_index = -1;
-    uint16_t hit_x = 0;
-    uint16_t hit_y = 0;
-    
-    for (int i = 0; i < MAX_SHIPS; i++) {
-        if (ships[i].active) {
-            int dx = ch_x - ships[i].x;
-            int dy = ch_y - ships[i].y;
-            int dist_sq = dx * dx + dy * dy;
-            
-            int r_squared;
-            if (ships[i].type == 10) {
-                r_squared = 25 * 25; 
-            } else if (ships[i].type == 20) {
-                r_squared = 35 * 35;  
-            } else {
-                r_squared = 45 * 45;  
-            }
-            
-            if (dist_sq <= r_squared) {
-                hit = 1;
-                hit_type = ships[i].type;
-                hit_index = i;
-                hit_x = ships[i].x;
-                hit_y = ships[i].y;
-                break;
-            }
-        }
-    }
-    if (hit) {
-        ships[hit_index].active = 0;
-        log_to_buffer("RESULT:HIT:%d,%d,%d", hit_type, hit_x, hit_y); 
-    } else {
-        log_to_buffer("RESULT:MISS,%d,%d", ch_x, ch_y);
+// Called first thing in every pass of the main loop
+static void prof_loop_start(uint8_t timer) {
+    uint32_t now = DWT->CYCCNT;
+    prof_record(PROF_LOOP, now - prof_loop_at);
+    prof_loop_at = now;
+    if (timer && prof_wake_valid) {
+        prof_wake_valid = 0;
+        prof_record(PROF_WAKE, now - prof_wake_at);
     }
 }
-// =============== STORM GENERATOR ===============
-void get_storm_offsets(int16_t* out_x, int16_t* out_y) {
-    uint32_t t = HAL_GetTick();
-    float phase_x = 2.0f * 3.14159265f * (t % (uint32_t)STORM_PERIOD_X_MS) / STORM_PERIOD_X_MS;
-    float phase_y = 2.0f * 3.14159265f * (t % (uint32_t)STORM_PERIOD_Y_MS) / STORM_PERIOD_Y_MS;
-    *out_x = (int16_t)(storm_amplitude_x * sinf(phase_x));
-    *out_y = (int16_t)(storm_amplitude_y * sinf(phase_y + 0.7f)); 
-}
-// =============== UART COMMANDS ===============
-void check_uart_commands(void) {
-    static uint8_t checked_index = 0;
-    uint16_t current_index = RX_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(&hdma_usart2_rx);
-    if (current_index >= RX_BUFFER_SIZE) current_index = 0;
-
-    while (checked_index != current_index) {
-        uint8_t ch = rx_dma_buffer[checked_index];
-        checked_index = (checked_index + 1) % RX_BUFFER_SIZE;
-
-        if (ch == '\r' || ch == '\n') {
-            if (cmd_ready == 0 && strlen(cmd_line) > 0) {
-                cmd_ready = 1;
-            }
-        } else if (strlen(cmd_line) < CMD_LINE_SIZE - 1) {
-            strncat(cmd_line, (char*)&ch, 1);
-        } else {
-            cmd_ready = 0;
-            memset(cmd_line, 0, sizeof(cmd_line));
-        }
-    }
+#endif
+
+// The F103 has no RNG peripheral: mix the unique device ID with the
+// SysTick phase and tick count at the moment of the call. Called on
+// START, whose timing is set by the player. Kept to 31 bits so that
+// CMD:SEED can replay it.
+uint32_t rng_entropy(void) {
+    const uint32_t *uid = (const uint32_t *)UID_BASE;
+    uint32_t e = uid[0] ^ (uid[1] * 0x9E3779B9u) ^ (uid[2] << 7);
+    e ^= (SysTick->VAL << 16) ^ HAL_GetTick();
+    e ^= e >> 15;
+    e *= 0x2C1B3C6Du;
+    e ^= e >> 12;
+    return e & INT32_MAX;
 }
 
 // =============== BUTTON HANDLING ===============
-void process_buttons(uint32_t current_time) {
-    static uint32_t last_check = 0;
-    if (current_time - last_check < 30) return;
-    last_check = current_time;
-
-    uint8_t left_now = HAL_GPIO_ReadPin(LEFT_BUTTON_GPIO_Port, LEFT_BUTTON_Pin);
-    uint8_t right_now = HAL_GPIO_ReadPin(RIGHT_BUTTON_GPIO_Port, RIGHT_BUTTON_Pin);
-    uint8_t middle_now = HAL_GPIO_ReadPin(MIDDLE_BUTTON_GPIO_Port, MIDDLE_BUTTON_Pin);
-
-    // LEFT
-    if (left_button_prev == 1 && left_now == 0) {
-        if (game_started && !game_paused) {
-						if (crosshair_x > MIN_X) {
-							crosshair_x -= CROSSHAIR_STEP_X;
-						}		  
-						log_to_buffer("CROSSHAIR_STEP_LEFT");
-        }
-    }
-    left_button_prev = left_now;
-
-    // RIGHT
-    if (right_button_prev == 1 && right_now == 0) {
-        if (game_started && !game_paused) {
-            if (crosshair_x < MAX_X) {
-								crosshair_x += CROSSHAIR_STEP_X;
-						}
-						log_to_buffer("CROSSHAIR_STEP_RIGHT");
+// Falling edge = press. The first edge is taken at once and its line is
+// masked, so contact bounce never reaches the FIFO.
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+    uint8_t b = 0;
+    while (b < BTN_COUNT && button_pin[b] != GPIO_Pin) b++;
+    if (b == BTN_COUNT) return;
+
+    uint32_t now = HAL_GetTick();
+    EXTI->IMR &= ~(uint32_t)GPIO_Pin;
+    button_masked[b] = 1;
+    button_release_at[b] = now + DEBOUNCE_DELAY;
+    button_push(b, now);
+}
+
+// SysTick: re-arms a masked line once its button has stayed released for
+// DEBOUNCE_DELAY. Holding the button keeps pushing the deadline out.
+void buttons_debounce_tick(uint32_t now) {
+    for (uint8_t b = 0; b < BTN_COUNT; b++) {
+        if (!button_masked[b]) continue;
+        if (HAL_GPIO_ReadPin(button_port[b], button_pin[b]) == GPIO_PIN_RESET) {
+            button_release_at[b] = now + DEBOUNCE_DELAY;
+        } else if ((int32_t)(now - button_release_at[b]) >= 0) {
+            // SysTick has the lowest priority: keep the EXTI handlers out of
+            // the read-modify-write of IMR
+            uint32_t primask = __get_PRIMASK();
+            __disable_irq();
+            __HAL_GPIO_EXTI_CLEAR_IT(button_pin[b]);
+            button_masked[b] = 0;
+            EXTI->IMR |= button_pin[b];
+            __set_PRIMASK(primask);
         }
     }
-    right_button_prev = right_now;
-
-    // MIDDLE
-		if (middle_button_prev == 1 && middle_now == 0) {
-				if (game_started && !game_paused) {
-						
-						if (!crosshair_locked) {
-								crosshair_locked = 1;
-								log_to_buffer("MIDDLE_CLICK:%d,%d", crosshair_x, crosshair_y);
-								
-						} else {
-								crosshair_locked = 0;
-								log_to_buffer("MIDDLE_CLICK:%d,%d", crosshair_x, crosshair_y);
-						}
-				}
-		}
-    middle_button_prev = middle_now;
 }
 
-// =============== GAME UPDATE ===============
-void update_game_logic(uint32_t current_time) {
-    if (!game_started || game_paused) return;
-
-    // Spawn ships every 2 seconds
-    if (current_time - last_ship_spawn >= 4000) {
-        last_ship_spawn = current_time;
-        spawn_ship();
-    }
+// =============== BOARD COMMANDS ===============
+// Idle share of the time since the previous STATUS, in tenths of a percent
+void cmd_status(void) {
+    __disable_irq();
+    uint32_t now = HAL_GetTick();
+    uint64_t idle_us = loop_idle_us;
+    uint32_t wakeups = loop_wakeups;
+    loop_idle_us = 0;
+    loop_wakeups = 0;
+    __enable_irq();
+
+    uint32_t window_ms = now - loop_stats_since;
+    loop_stats_since = now;
+    uint64_t window_us = (uint64_t)window_ms * 1000;
+    if (idle_us > window_us) idle_us = window_us;    // the window has whole-ms resolution
+    uint32_t idle_permille = window_us ? (uint32_t)(idle_us * 1000 / window_us) : 0;
+    log_to_buffer("STATUS:IDLE:%lu,%lu,%lu", (unsigned long)idle_permille,
+                  (unsigned long)wakeups, (unsigned long)window_ms);
+}
 
-    // Timer tick every second
-    if (current_time - last_second_tick >= 1000) {
-        last_second_tick = current_time;
-        if (game_time > 0) {
-            game_time--;
-            log_to_buffer("TIME:%d", game_time);
-            if (game_time == 0) {
-								game_started = 0;
+#if PROFILE_ENABLE
+// Cycle counts at SystemCoreClock: PROF:<stage>:count,min,mean,max, then
+// the non-empty stretch of the histogram as PROF_HIST:<stage>:<first bin>:counts
+void cmd_prof(void) {
+    log_to_buffer("PROF:CLK:%lu", (unsigned long)SystemCoreClock);
+    for (int i = 0; i < PROF_STAGE_COUNT; i++) {
+        const ProfStat *p = &prof[i];
+        if (!p->count) continue;
+        log_to_buffer("PROF:%s:%lu,%lu,%lu,%lu", prof_names[i], (unsigned long)p->count,
+                      (unsigned long)p->min, (unsigned long)(p->sum / p->count),
+                      (unsigned long)p->max);
+
+        int first = 0, last = PROF_BINS - 1;
+        while (!p->hist[first]) first++;
+        while (!p->hist[last]) last--;
+        for (int b = first; b <= last; b += 8) {
+            char line[96];
+            int len = 0;
+            for (int k = b; k <= last && k < b + 8; k++) {
+                len += snprintf(&line[len], sizeof(line) - len, "%s%lu",
+                                (k == b) ? "" : ",", (unsigned long)p->hist[k]);
             }
+            log_to_buffer("PROF_HIST:%s:%d:%s", prof_names[i], b, line);
         }
-    }
-		
-		// Storm logic
-		if (current_time - last_storm_update >= STORM_UPDATE_INTERVAL_MS) {
-        last_storm_update = current_time;
-        int16_t sx, sy;
-        get_storm_offsets(&sx, &sy);
-        log_to_buffer("STORM:%d,%d", sx, sy);
     }
 }
 
-// =============== COMMAND HANDLING ===============
-void handle_commands(void) {
-    if (!cmd_ready) return;
-    cmd_ready = 0;
-    char *cmd = cmd_line;
-
-    if (strncmp(cmd, "CMD:START", 9) == 0) {	
-        game_started = 1;
-        game_paused = 0;
-        crosshair_locked = 0;
-        crosshair_x = 400;
-        crosshair_y = 300;
-        vertical_direction = 1;
-        for (int i = 0; i < MAX_SHIPS; i++) ships[i].active = 0;
-        last_ship_spawn = HAL_GetTick();
-        last_second_tick = HAL_GetTick();
-        log_to_buffer("COM: START=%d, PAUSE=%d", game_started, game_paused);
-        log_to_buffer("TIME:%d", game_time);
-    }
-    else if (strncmp(cmd, "CMD:PAUSE", 9) == 0) {
-        game_started = 1;
-        game_paused = !game_paused;
-				if (!game_paused) {
-						last_second_tick = HAL_GetTick();
-				}
-        log_to_buffer("COM: START=%d, PAUSE=%d", game_started, game_paused);
-    }
-    else if (strncmp(cmd, "CMD:RESET", 9) == 0) {
-				game_started = 0;
-        game_paused = 0;
-        game_time = 60;
-        crosshair_locked = 0;
-        crosshair_x = 400;
-        crosshair_y = 300;
-        for (int i = 0; i < MAX_SHIPS; i++) ships[i].active = 0;
-        log_to_buffer("COM: reset=1");
-        log_to_buffer("TIME:%d", game_time);
-    }
-    else if (strncmp(cmd, "CMD:SHOT:", 9) == 0) {
-				char *comma = strchr(cmd + 9, ',');
-				if (comma) {
-						uint16_t x = atoi(cmd + 9);      
-						uint16_t y = atoi(comma + 1);      
-						check_ship_hit(x, y);
-						crosshair_locked = 0;             
-				}
-		}
-		else if (strncmp(cmd, "CMD:STORM_UPDATE:", 17) == 0) {
-				char* comma = strchr(cmd + 17, ',');
-				if (comma) {
-						int16_t delta_x = atoi(cmd + 17);
-						int16_t delta_y = atoi(comma + 1);
-
-						int16_t new_x = (int16_t)storm_amplitude_x + delta_x * 5;
-						int16_t new_y = (int16_t)storm_amplitude_y + delta_y * 5;
-
-						if (new_x < 0) new_x = 0;
-						if (new_x > 50) new_x = 50;
-						if (new_y < 0) new_y = 0;
-						if (new_y > 50) new_y = 50;
-
-						storm_amplitude_x = (float)new_x;
-						storm_amplitude_y = (float)new_y;
-
-						log_to_buffer("STORM_AMP_UPDATED:%d,%d", new_x, new_y);
-				}
-		}
-    else {
-        log_to_buffer("COM: unknown cmd: %s", cmd);
-    }
-
-    memset(cmd_line, 0, CMD_LINE_SIZE);
+void cmd_prof_reset(void) {
+    prof_reset();
+    log_to_buffer("PROF_RESET");
 }
+#endif
 /* USER CODE END 0 */
 
 /**
@@ -459,39 +305,28 @@ int main(void)
     MX_TIM2_Init();
     MX_USART2_UART_Init();
 
-    /* Initialize UART DMA */
-    HAL_UART_Receive_DMA(&huart2, rx_dma_buffer, RX_BUFFER_SIZE);
-
-    /* Initial state */
+    app_init();
+#if PROFILE_ENABLE
+    dwt_init();
+    prof_reset();
+#endif
     HAL_GPIO_WritePin(BUZZER_GPIO_Port, BUZZER_Pin, GPIO_PIN_SET);
-    last_second_tick = HAL_GetTick();
-    last_blink_tick = HAL_GetTick();
 
     /* Infinite loop */
     while (1)
     {
         uint32_t current_time = HAL_GetTick();
-
-        // =============== SERIAL COMMUNICATION ===============
-        check_uart_commands();
-        handle_commands();
-
-        // =============== INPUT HANDLING ===============
-        process_buttons(current_time);
-
-        // =============== GAME LOGIC ===============
-        update_game_logic(current_time);
-
-        // =============== DISPLAY ===============
-        if (game_started && game_paused) {
-            if (current_time - last_blink_tick >= 500) {
-                last_blink_tick = current_time;
-                display_on = !display_on;
-            }
-        } else {
-            display_on = 1;
-        }
-        updateDisplay();
+        uint8_t rx = event_take(EVT_RX);
+        uint8_t button = event_take(EVT_BUTTON);
+        uint8_t timer = event_take(EVT_TIMER);
+        event_take(EVT_TX);     // only wakes baud_service() once TX has drained
+#if PROFILE_ENABLE
+        prof_loop_start(timer);
+#endif
+        app_pass(current_time, rx, button, timer);
+
+        // =============== SLEEP ===============
+        loop_sleep(loop_next_deadline(current_time));
     }
 }
 
@@ -549,3 +384,4 @@ void assert_failed(uint8_t *file, uint32_t line)
     /* USER CODE END 6 */
 }
 #endif /* USE_FULL_ASSERT */
+
@@ -60,7 +60,7 @@ extern DMA_HandleTypeDef hdma_usart2_rx;
 extern DMA_HandleTypeDef hdma_usart2_tx;
 extern UART_HandleTypeDef huart2;
 /* USER CODE BEGIN EV */
-
+extern DMA_HandleTypeDef hdma_tim3_up;
 /* USER CODE END EV */
 
 /******************************************************************************/
@@ -190,7 +190,7 @@ void SysTick_Handler(void)
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
-
+  loop_systick();
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -299,5 +299,11 @@ void USART2_IRQHandler(void)
 }
 
 /* USER CODE BEGIN 1 */
-
+/**
+  * @brief This function handles DMA1 channel3 global interrupt (display waveform).
+  */
+void DMA1_Channel3_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_tim3_up);
+}
 /* USER CODE END 1 */
@@ -21,7 +21,10 @@
 #include "tim.h"
 
 /* USER CODE BEGIN 0 */
-
+/* TIM3 and its update DMA request are not part of the CubeMX configuration:
+   they only pace the display shift-register waveform, see MX_TIM3_DisplayDMA_Init */
+TIM_HandleTypeDef htim3;
+DMA_HandleTypeDef hdma_tim3_up;
 /* USER CODE END 0 */
 
 TIM_HandleTypeDef htim2;
@@ -107,5 +110,45 @@ void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef* tim_baseHandle)
 }
 
 /* USER CODE BEGIN 1 */
+/* TIM3 update events move one 32-bit word per period from memory to a GPIO
+   BSRR register through DMA1 channel 3 (the TIM3_UP request). The counter is
+   only enabled while a waveform is being sent. */
+void MX_TIM3_DisplayDMA_Init(uint32_t word_rate_hz)
+{
+  uint32_t timer_clock = HAL_RCC_GetPCLK1Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1)
+  {
+    timer_clock *= 2;
+  }
 
+  __HAL_RCC_TIM3_CLK_ENABLE();
+  htim3.Instance = TIM3;
+  htim3.Init.Prescaler = 0;
+  htim3.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim3.Init.Period = timer_clock / word_rate_hz - 1;
+  htim3.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim3.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+  if (HAL_TIM_Base_Init(&htim3) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  hdma_tim3_up.Instance = DMA1_Channel3;
+  hdma_tim3_up.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_tim3_up.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_tim3_up.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_tim3_up.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+  hdma_tim3_up.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+  hdma_tim3_up.Init.Mode = DMA_NORMAL;
+  hdma_tim3_up.Init.Priority = DMA_PRIORITY_MEDIUM;
+  if (HAL_DMA_Init(&hdma_tim3_up) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  __HAL_LINKDMA(&htim3, hdma[TIM_DMA_ID_UPDATE], hdma_tim3_up);
+  __HAL_TIM_ENABLE_DMA(&htim3, TIM_DMA_UPDATE);
+
+  HAL_NVIC_SetPriority(DMA1_Channel3_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel3_IRQn);
+}
 /* USER CODE END 1 */
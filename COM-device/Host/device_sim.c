@@ -0,0 +1,340 @@
+/**
+  ******************************************************************************
+  * @file    device_sim.c
+  * @brief   Headless simulator of the device: the firmware main loop on a
+  *          virtual clock, fed from a command script on stdin, writing the
+  *          UART byte stream the board would send to stdout.
+  *
+  *          device_sim [--speed N] [--until MS] [--sessions N] [--seed-base S]
+  *                     [--quiet] < script
+  *
+  *          Script lines, '#' starts a comment:
+  *            @<ms> <data>    data arrives at virtual time ms
+  *            +<ms> <data>    ms after the previous line
+  *            <data>          together with the previous line
+  *            @<ms>           nothing arrives, but the run lasts until ms
+  *          Data is BTN:LEFT, BTN:RIGHT or BTN:MIDDLE for a button press,
+  *          otherwise bytes for the RX pin. \xHH, \r, \n, \0 and \\ escapes
+  *          are decoded, and a CMD: line gets its '\n' appended.
+  *
+  *          The run ends once the script is over and no game is running,
+  *          or at --until (default 120000 ms). Transfers take the time of
+  *          their bytes at the current baud rate, 10 bits per byte, so TX
+  *          ring overflows happen as they would on the board.
+  *
+  *          --speed N paces the virtual clock at N times real time; without
+  *          it the simulation runs as fast as it can. --sessions N replays
+  *          the script N times, each from the state right after boot, and
+  *          --seed-base S sends CMD:SEED:<S + session> first in each of them.
+  *          --quiet drops the output. Timing goes to stderr.
+  ******************************************************************************
+  */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "host_board.h"
+#include "app.h"
+#include "game.h"
+#include "usart.h"
+
+#define SCRIPT_LINE_SIZE        512
+#define DEFAULT_UNTIL_MS        120000
+
+typedef struct {
+    uint32_t at;        // virtual ms
+    int16_t button;     // ButtonId, or -1 for RX bytes
+    uint16_t len;
+    uint8_t *data;
+} ScriptItem;
+
+typedef struct {
+    ScriptItem *items;
+    uint32_t count;
+    uint32_t cap;
+    uint32_t end;       // last time the script names
+} Script;
+
+typedef struct {
+    double speed;
+    uint32_t until;
+    uint32_t sessions;
+    long seed_base;
+    int quiet;
+} SimOptions;
+
+typedef struct {
+    uint64_t virtual_ms;
+    uint64_t bytes;
+} SimResult;
+
+// =============== SCRIPT ===============
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static uint16_t unescape(const char *src, uint8_t *dst) {
+    uint16_t n = 0;
+    while (*src) {
+        char c = *src++;
+        if (c != '\\' || !*src) {
+            dst[n++] = (uint8_t)c;
+            continue;
+        }
+        c = *src++;
+        if (c == 'x' && hex_digit(src[0]) >= 0 && hex_digit(src[1]) >= 0) {
+            dst[n++] = (uint8_t)(hex_digit(src[0]) << 4 | hex_digit(src[1]));
+            src += 2;
+        } else if (c == 'r') {
+            dst[n++] = '\r';
+        } else if (c == 'n') {
+            dst[n++] = '\n';
+        } else if (c == '0') {
+            dst[n++] = 0;
+        } else {
+            dst[n++] = (uint8_t)c;
+        }
+    }
+    return n;
+}
+
+static void script_add(Script *s, uint32_t at, int16_t button, const uint8_t *data, uint16_t len) {
+    if (s->count == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 64;
+        s->items = realloc(s->items, s->cap * sizeof(ScriptItem));
+        if (!s->items) {
+            perror("device_sim");
+            exit(1);
+        }
+    }
+    ScriptItem *it = &s->items[s->count++];
+    it->at = at;
+    it->button = button;
+    it->len = len;
+    it->data = NULL;
+    if (len) {
+        it->data = malloc(len);
+        memcpy(it->data, data, len);
+    }
+}
+
+static int script_read(FILE *f, Script *s) {
+    static const char *const buttons[BTN_COUNT] = { "BTN:LEFT", "BTN:RIGHT", "BTN:MIDDLE" };
+    char line[SCRIPT_LINE_SIZE];
+    uint8_t data[SCRIPT_LINE_SIZE + 1];
+    uint32_t at = 0;
+    int lineno = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        line[strcspn(line, "\r\n")] = '\0';
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0' || *p == '#') continue;
+
+        if (*p == '@' || *p == '+') {
+            char *end;
+            errno = 0;
+            unsigned long v = strtoul(p + 1, &end, 10);
+            if (end == p + 1 || errno || v > UINT32_MAX) {
+                fprintf(stderr, "device_sim: line %d: bad time\n", lineno);
+                return -1;
+            }
+            uint32_t t = (*p == '@') ? (uint32_t)v : at + (uint32_t)v;
+            if (t < at) {
+                fprintf(stderr, "device_sim: line %d: time goes backwards\n", lineno);
+                return -1;
+            }
+            at = t;
+            p = end;
+            while (*p == ' ' || *p == '\t') p++;
+        }
+        if (at > s->end) s->end = at;
+        if (*p == '\0') continue;
+
+        int16_t button = -1;
+        for (int b = 0; b < BTN_COUNT; b++) {
+            if (strcmp(p, buttons[b]) == 0) button = b;
+        }
+        if (button >= 0) {
+            script_add(s, at, button, NULL, 0);
+            continue;
+        }
+        uint16_t len = unescape(p, data);
+        if (strncmp(p, "CMD:", 4) == 0) data[len++] = '\n';
+        script_add(s, at, -1, data, len);
+    }
+    return 0;
+}
+
+// =============== SIMULATION ===============
+static uint64_t real_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void write_out(const uint8_t *data, uint16_t len, void *ctx) {
+    SimResult *r = ctx;
+    r->bytes += len;
+    fwrite(data, 1, len, stdout);
+}
+
+// Time on the wire of a transfer at the current baud rate, in microseconds
+static uint64_t tx_time_us(uint16_t len) {
+    uint32_t baud = huart2.Init.BaudRate ? huart2.Init.BaudRate : 115200;
+    return ((uint64_t)len * 10 * 1000000 + baud - 1) / baud;
+}
+
+static SimResult simulate(const Script *s, const SimOptions *opt, long seed) {
+    SimResult r = {0, 0};
+    uint64_t now = 0;                   // virtual microseconds
+    uint64_t tx_end = UINT64_MAX;       // end of the transfer on the wire
+    uint64_t real_start = real_us();
+    uint32_t next_item = 0;
+    uint32_t deadline = 0;
+
+    if (seed >= 0) {
+        char cmd[32];
+        int n = snprintf(cmd, sizeof(cmd), "CMD:SEED:%ld\n", seed);
+        hal_shim_uart_rx((const uint8_t *)cmd, n);
+    }
+
+    for (;;) {
+        uint32_t tick = (uint32_t)(now / 1000);
+
+        while (next_item < s->count && s->items[next_item].at <= tick) {
+            const ScriptItem *it = &s->items[next_item++];
+            if (it->button >= 0) {
+                button_push((uint8_t)it->button, tick);
+            } else {
+                hal_shim_uart_rx(it->data, it->len);
+            }
+        }
+
+        const uint8_t *data;
+        uint16_t len = hal_shim_uart_tx_pending(&data);
+        if (len && tx_end <= now) {
+            if (!opt->quiet) write_out(data, len, &r);
+            else r.bytes += len;
+            tx_end = UINT64_MAX;
+            hal_shim_uart_tx_done();
+        }
+
+        deadline = host_loop_step(tick);
+
+        len = hal_shim_uart_tx_pending(&data);
+        if (len && tx_end == UINT64_MAX) {
+            tx_end = now + tx_time_us(len);
+        }
+
+        // Done when nothing is left to arrive, to play or to send
+        if (tick >= opt->until) break;
+        if (next_item == s->count && tick >= s->end && !game_started && !len) break;
+
+        uint64_t next = (uint64_t)deadline * 1000;
+        if (next_item < s->count && (uint64_t)s->items[next_item].at * 1000 < next) {
+            next = (uint64_t)s->items[next_item].at * 1000;
+        }
+        if (s->end > tick && (uint64_t)s->end * 1000 < next) next = (uint64_t)s->end * 1000;
+        if (len && tx_end < next) next = tx_end;
+        if (next <= now) next = now + 1;
+        if (next > (uint64_t)opt->until * 1000) next = (uint64_t)opt->until * 1000;
+        now = next;
+
+        if (opt->speed > 0) {
+            uint64_t target = real_start + (uint64_t)(now / opt->speed);
+            uint64_t t = real_us();
+            if (target > t) usleep((useconds_t)(target - t));
+        }
+    }
+    fflush(stdout);
+    r.virtual_ms = now / 1000;
+    return r;
+}
+
+// Every session starts from the state right after boot: forked from it
+static SimResult simulate_session(const Script *s, const SimOptions *opt, long seed) {
+    SimResult r = {0, 0};
+    int fd[2];
+    fflush(stdout);
+    if (pipe(fd) != 0) {
+        perror("device_sim");
+        exit(1);
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("device_sim");
+        exit(1);
+    }
+    if (pid == 0) {
+        close(fd[0]);
+        r = simulate(s, opt, seed);
+        if (write(fd[1], &r, sizeof(r)) != (ssize_t)sizeof(r)) _exit(1);
+        _exit(0);
+    }
+    close(fd[1]);
+    if (read(fd[0], &r, sizeof(r)) != (ssize_t)sizeof(r)) {
+        fprintf(stderr, "device_sim: session failed\n");
+    }
+    close(fd[0]);
+    waitpid(pid, NULL, 0);
+    return r;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: device_sim [--speed N] [--until MS] [--sessions N] "
+                    "[--seed-base S] [--quiet] < script\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    SimOptions opt = { 0.0, DEFAULT_UNTIL_MS, 1, -1, 0 };
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quiet") == 0) {
+            opt.quiet = 1;
+        } else if (i + 1 < argc && strcmp(argv[i], "--speed") == 0) {
+            opt.speed = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--until") == 0) {
+            opt.until = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--sessions") == 0) {
+            opt.sessions = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed-base") == 0) {
+            opt.seed_base = strtol(argv[++i], NULL, 10);
+            if (opt.seed_base < 0 || opt.seed_base > INT32_MAX) usage();
+        } else {
+            usage();
+        }
+    }
+    if (opt.sessions == 0) usage();
+
+    Script script = {0};
+    if (script_read(stdin, &script) != 0) return 1;
+
+    app_init();
+
+    uint64_t start = real_us();
+    SimResult total = {0, 0};
+    for (uint32_t i = 0; i < opt.sessions; i++) {
+        long seed = -1;
+        if (opt.seed_base >= 0) seed = (opt.seed_base + i) & INT32_MAX;
+        SimResult r = (opt.sessions == 1) ? simulate(&script, &opt, seed)
+                                          : simulate_session(&script, &opt, seed);
+        total.virtual_ms += r.virtual_ms;
+        total.bytes += r.bytes;
+    }
+    uint64_t wall = real_us() - start;
+
+    fprintf(stderr, "SIM:%lu sessions, %llu virtual ms, %llu bytes, %.3f wall ms, %.0fx\n",
+            (unsigned long)opt.sessions, (unsigned long long)total.virtual_ms,
+            (unsigned long long)total.bytes, wall / 1000.0,
+            wall ? total.virtual_ms * 1000.0 / wall : 0.0);
+    return 0;
+}
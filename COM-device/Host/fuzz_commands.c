@@ -0,0 +1,156 @@
+/**
+  ******************************************************************************
+  * @file    fuzz_commands.c
+  * @brief   Fuzz target for everything behind the RX pin: the DMA ring, line
+  *          and frame splitting, the text and binary command parsers and the
+  *          commands they run.
+  *
+  *          The input is a sequence of chunks. A control byte gives the chunk
+  *          length (low 5 bits + 1) and how long the line then stays quiet
+  *          (high 3 bits, 250 ms steps), so ring wrap-around, half/full
+  *          transfer events and the game clock are all reached. 0xFF instead
+  *          presses the button named by the next byte.
+  *
+  *          After every chunk the game state is checked against its bounds,
+  *          and after the input CMD:STATS must still be answered; a failure
+  *          aborts with the reason. Memory errors are left to the sanitizers.
+  *
+  *          Built with libFuzzer under Clang (fuzz_commands), and as
+  *          fuzz_commands_replay everywhere to run a corpus or crash file.
+  ******************************************************************************
+  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_board.h"
+#include "app.h"
+#include "comm.h"
+#include "commands.h"
+#include "game.h"
+
+#define FUZZ_QUIET_STEP_MS      250
+#define FUZZ_BUTTON_MARK        0xFF
+// An open frame takes at most a slot before it overflows and CR/LF ends it,
+// so one of these probes must reach the parser as a text line
+#define FUZZ_PROBE              "CMD:STATS\r\n"
+#define FUZZ_PROBE_TRIES        (CMD_LINE_SIZE / (sizeof(FUZZ_PROBE) - 1) + 2)
+#define FUZZ_REPLY_SIZE         4096
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static uint8_t initialized = 0;
+static uint32_t tick = 0;
+static StormParams storm_default;
+static char reply[FUZZ_REPLY_SIZE];
+static uint32_t reply_len = 0;
+
+static void fail(const char *what) {
+    fprintf(stderr, "fuzz_commands: invariant broken: %s\n", what);
+    abort();
+}
+
+static void check_state(void) {
+    if (ship_count > MAX_SHIPS) fail("ship_count");
+    if (crosshair_x > FIELD_WIDTH || crosshair_y > FIELD_HEIGHT) fail("crosshair outside the field");
+    if (game_time > 60) fail("game_time");
+    if (storm.amp_x < 0 || storm.amp_x > 50 || storm.amp_y < 0 || storm.amp_y > 50) fail("storm amplitude");
+    if (storm_update_interval_ms < 20 || storm_update_interval_ms > 1000) fail("storm interval");
+
+    uint32_t listed = 0;
+    for (uint32_t n = 0; n < ship_count; n++) {
+        const Ship *s = &ships[ship_list[n]];
+        if (ship_list[n] >= MAX_SHIPS) fail("ship_list slot");
+        if (s->pos != n) fail("ship pos");
+        if (s->type != 10 && s->type != 20 && s->type != 30) fail("ship type");
+        if (s->x < MIN_X || s->x > MAX_X || s->y < MIN_Y || s->y > MAX_Y) fail("ship outside the field");
+    }
+    for (uint32_t c = 0; c < GRID_ROWS * GRID_COLS; c++) {
+        for (uint16_t i = ship_grid[c]; i != GRID_NONE; i = ships[i].next) {
+            if (i >= MAX_SHIPS) fail("grid slot");
+            if (++listed > ship_count) fail("grid holds more ships than the list");
+        }
+    }
+    if (listed != ship_count) fail("grid and list disagree");
+}
+
+// Keeps what the device sends, so a probe can look for its reply
+static void capture(const uint8_t *data, uint16_t len, void *ctx) {
+    (void)ctx;
+    if (len > FUZZ_REPLY_SIZE - 1 - reply_len) len = (uint16_t)(FUZZ_REPLY_SIZE - 1 - reply_len);
+    memcpy(&reply[reply_len], data, len);
+    reply_len += len;
+}
+
+// Runs the loop until the virtual clock reaches until, draining the UART
+static void run_until(uint32_t until) {
+    do {
+        hal_shim_uart_flush(capture, NULL);
+        uint32_t deadline = host_loop_step(tick);
+        hal_shim_uart_flush(capture, NULL);
+        if (host_events_pending()) continue;
+        if ((int32_t)(deadline - until) > 0) deadline = until;
+        tick = deadline;
+    } while ((int32_t)(tick - until) < 0);
+    host_loop_step(tick);
+    hal_shim_uart_flush(capture, NULL);
+}
+
+// Whatever the input left behind, the receiver must still take commands.
+// In binary mode the reply is a TEXT frame, whose bytes stay readable.
+static void check_responsive(void) {
+    for (uint32_t i = 0; i < FUZZ_PROBE_TRIES; i++) {
+        reply_len = 0;
+        hal_shim_uart_rx((const uint8_t *)FUZZ_PROBE, sizeof(FUZZ_PROBE) - 1);
+        run_until(tick + 1);
+        reply[reply_len] = '\0';
+        for (uint32_t at = 0; at < reply_len; at += (uint32_t)strlen(&reply[at]) + 1) {
+            if (strstr(&reply[at], "STATS:RX:")) return;
+        }
+    }
+    fail("CMD:STATS not answered");
+}
+
+// Every input starts from the same state, so a crash file replays alone
+static void reset_state(void) {
+    // Lets a pending baud change run out into its fallback
+    run_until(tick + 2 * BAUD_PROBE_TIMEOUT_MS);
+
+    cmd_proto(PROTO_ASCII);
+    cmd_rel(0);
+    cmd_agg(0);
+    cmd_ts(0);
+    cmd_storm_mode(0);
+    cmd_storm_hz(10);
+    cmd_reset();
+    cmd_seed(1);
+    storm = storm_default;
+    logging_enabled = 1;
+    run_until(tick + 1);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (!initialized) {
+        storm_default = storm;
+        app_init();
+        initialized = 1;
+    }
+    reset_state();
+
+    size_t i = 0;
+    while (i < size) {
+        uint8_t ctl = data[i++];
+        if (ctl == FUZZ_BUTTON_MARK) {
+            if (i < size) button_push(data[i++] % BTN_COUNT, tick);
+        } else {
+            size_t len = (ctl & 0x1F) + 1;
+            if (len > size - i) len = size - i;
+            hal_shim_uart_rx(&data[i], (uint32_t)len);
+            i += len;
+        }
+        run_until(tick + (ctl >> 5) * FUZZ_QUIET_STEP_MS);
+        check_state();
+    }
+    check_responsive();
+    return 0;
+}
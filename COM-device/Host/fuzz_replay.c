@@ -0,0 +1,67 @@
+/**
+  ******************************************************************************
+  * @file    fuzz_replay.c
+  * @brief   main() for running a libFuzzer target without libFuzzer: every
+  *          file named on the command line, or in a directory named there,
+  *          is passed to LLVMFuzzerTestOneInput once.
+  ******************************************************************************
+  */
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static int replay_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    size_t cap = 4096, size = 0;
+    uint8_t *data = malloc(cap);
+    size_t n;
+    while (data && (n = fread(data + size, 1, cap - size, f)) > 0) {
+        size += n;
+        if (size == cap) data = realloc(data, cap *= 2);
+    }
+    fclose(f);
+    if (!data) {
+        perror(path);
+        return 1;
+    }
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int errors = 0, runs = 0;
+    for (int a = 1; a < argc; a++) {
+        struct stat st;
+        if (stat(argv[a], &st) != 0) {
+            perror(argv[a]);
+            errors++;
+            continue;
+        }
+        if (!S_ISDIR(st.st_mode)) {
+            errors += replay_file(argv[a]);
+            runs++;
+            continue;
+        }
+        DIR *d = opendir(argv[a]);
+        struct dirent *e;
+        while (d && (e = readdir(d)) != NULL) {
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/%s", argv[a], e->d_name);
+            if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+            errors += replay_file(path);
+            runs++;
+        }
+        if (d) closedir(d);
+    }
+    fprintf(stderr, "fuzz_replay: %d inputs, %d unreadable\n", runs, errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,396 @@
+/**
+  ******************************************************************************
+  * @file    fw_bench.c
+  * @brief   Host microbenchmarks of the firmware hot paths: hit testing,
+  *          spawning, the RX and command paths, the storm generator and
+  *          log formatting.
+  *
+  *          fw_bench [--filter TEXT] [--min-time MS]
+  *
+  *          One CSV line per case: name,ns_per_op,allocs_per_op,ops. The
+  *          numbers are the median of BENCH_REPEATS runs of at least
+  *          --min-time ms each (default 100). Lines starting with '#' describe
+  *          the build, so two runs can be diffed directly.
+  *
+  *          Built with MAX_SHIPS=256 so hit testing can be run at counts above
+  *          the board's 25. The UART drains at once after every operation,
+  *          so the TX ring never fills and nothing is timed on the drop path.
+  ******************************************************************************
+  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <time.h>
+
+#include "host_board.h"
+#include "app.h"
+#include "comm.h"
+#include "commands.h"
+#include "game.h"
+
+#define BENCH_REPEATS           5
+#define SHOT_COUNT              1024    // power of two
+#define CLUSTER_SIZE            120     // px, side of the square clustered ships sit in
+
+typedef struct {
+    const char *name;
+    void (*setup)(uint32_t arg);
+    void (*op)(uint32_t i);
+    uint32_t arg;
+} BenchCase;
+
+static const char *filter = NULL;
+static double min_time_ms = 100.0;
+
+// =============== ALLOCATIONS ===============
+// glibc lets a program replace malloc; its own internal calls come here too
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void __libc_free(void *p);
+
+static volatile uint64_t alloc_count = 0;
+
+void *malloc(size_t size) {
+    alloc_count++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    alloc_count++;
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size) {
+    alloc_count++;
+    return __libc_realloc(p, size);
+}
+
+void free(void *p) {
+    __libc_free(p);
+}
+
+// =============== HELPERS ===============
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint32_t lcg_state = 1;
+
+// Benchmark inputs only, so the game's generator keeps its own sequence
+static uint32_t lcg_below(uint32_t n) {
+    lcg_state = lcg_state * 1664525u + 1013904223u;
+    return (uint32_t)(((uint64_t)lcg_state * n) >> 32);
+}
+
+static void drain(void) {
+    hal_shim_uart_flush(NULL, NULL);
+}
+
+static void fresh_state(void) {
+    drain();
+    cmd_reset();
+    cmd_proto(PROTO_ASCII);
+    drain();
+    lcg_state = 1;
+}
+
+static uint16_t shot_x[SHOT_COUNT];
+static uint16_t shot_y[SHOT_COUNT];
+static volatile int32_t sink;
+
+// =============== HIT TESTING ===============
+static void add_ship(uint8_t type, uint16_t x, uint16_t y) {
+    int slot = ship_alloc();
+    if (slot < 0) return;
+    ships[slot].type = type;
+    ships[slot].x = x;
+    ships[slot].y = y;
+    grid_insert(slot);
+}
+
+static void place_ships(uint32_t count, uint8_t cluster) {
+    fresh_state();
+    ship_pool_reset();
+    for (uint32_t n = 0; n < count; n++) {
+        uint8_t type = 10 + 10 * lcg_below(3);
+        if (cluster) {
+            add_ship(type, (FIELD_WIDTH - CLUSTER_SIZE) / 2 + lcg_below(CLUSTER_SIZE),
+                     (FIELD_HEIGHT - CLUSTER_SIZE) / 2 + lcg_below(CLUSTER_SIZE));
+        } else {
+            add_ship(type, MIN_X + lcg_below(MAX_X - MIN_X + 1), MIN_Y + lcg_below(MAX_Y - MIN_Y + 1));
+        }
+    }
+}
+
+static uint8_t in_range(uint16_t x, uint16_t y) {
+    for (uint32_t n = 0; n < ship_count; n++) {
+        const Ship *s = &ships[ship_list[n]];
+        int dx = x - s->x, dy = y - s->y;
+        if (dx * dx + dy * dy <= SHIP_MAX_RADIUS * SHIP_MAX_RADIUS) return 1;
+    }
+    return 0;
+}
+
+// Shots aimed where the ships are, none close enough to hit: the full scan
+static void aim_misses(uint8_t cluster) {
+    for (uint32_t i = 0; i < SHOT_COUNT; i++) {
+        uint16_t x, y;
+        uint32_t tries = 0;
+        do {
+            if (cluster) {
+                x = (FIELD_WIDTH - 2 * CLUSTER_SIZE) / 2 + lcg_below(2 * CLUSTER_SIZE);
+                y = (FIELD_HEIGHT - 2 * CLUSTER_SIZE) / 2 + lcg_below(2 * CLUSTER_SIZE);
+            } else {
+                x = lcg_below(FIELD_WIDTH + 1);
+                y = lcg_below(FIELD_HEIGHT + 1);
+            }
+        } while (in_range(x, y) && ++tries < 10000);
+        shot_x[i] = x;
+        shot_y[i] = y;
+    }
+}
+
+static void setup_miss_uniform(uint32_t count) {
+    place_ships(count, 0);
+    aim_misses(0);
+}
+
+static void setup_miss_cluster(uint32_t count) {
+    place_ships(count, 1);
+    aim_misses(1);
+}
+
+static void setup_hit_uniform(uint32_t count) {
+    place_ships(count, 0);
+}
+
+static void setup_hit_cluster(uint32_t count) {
+    place_ships(count, 1);
+}
+
+static void op_shot_miss(uint32_t i) {
+    check_ship_hit(shot_x[i & (SHOT_COUNT - 1)], shot_y[i & (SHOT_COUNT - 1)]);
+    drain();
+}
+
+// A direct hit on a listed ship, which is then put back in the freed slot
+static void op_shot_hit(uint32_t i) {
+    const Ship *s = &ships[ship_list[i % ship_count]];
+    uint8_t type = s->type;
+    uint16_t x = s->x, y = s->y;
+    check_ship_hit(x, y);
+    drain();
+    add_ship(type, x, y);
+}
+
+// =============== SPAWNING ===============
+static void setup_spawn(uint32_t arg) {
+    (void)arg;
+    fresh_state();
+    rng_set_seed(1);
+    ship_pool_reset();
+}
+
+// The pool is emptied every 25 ships, the board's own limit
+static void op_spawn(uint32_t i) {
+    (void)i;
+    if (ship_count == 25) ship_pool_reset();
+    spawn_ship();
+    drain();
+}
+
+// =============== COMMANDS ===============
+static uint8_t cmd_bytes[64];
+static uint32_t cmd_len = 0;
+
+static uint32_t cobs_frame(const uint8_t *msg, uint32_t len, uint8_t *out) {
+    uint8_t raw[64];
+    memcpy(raw, msg, len);
+    put_le16(&raw[len], crc16(msg, len));
+    len += 2;
+    // Opening delimiter, as the browser sends it
+    out[0] = 0x00;
+    uint32_t o = 2, code_at = 1;
+    uint8_t code = 1;
+    for (uint32_t i = 0; i < len; i++) {
+        if (raw[i] == 0) {
+            out[code_at] = code;
+            code_at = o++;
+            code = 1;
+        } else {
+            out[o++] = raw[i];
+            code++;
+        }
+    }
+    out[code_at] = code;
+    out[o++] = 0x00;
+    return o;
+}
+
+static const char *const text_cmds[] = {
+    "CMD:SHOT:400,300\n",
+    "CMD:STORM_UPDATE:1,-1\n",
+    "CMD:PING:1234567\n",
+    "CMD:NOPE\n",
+    "CMD:SHOT:400,x\n",
+};
+
+static void setup_text_cmd(uint32_t which) {
+    fresh_state();
+    ship_pool_reset();
+    cmd_len = (uint32_t)strlen(text_cmds[which]);
+    memcpy(cmd_bytes, text_cmds[which], cmd_len);
+}
+
+static void setup_bin_shot(uint32_t arg) {
+    (void)arg;
+    fresh_state();
+    ship_pool_reset();
+    uint8_t msg[5] = { MSG_CMD_SHOT };
+    put_le16(&msg[1], 400);
+    put_le16(&msg[3], 300);
+    cmd_len = cobs_frame(msg, sizeof(msg), cmd_bytes);
+}
+
+// Bytes through the RX DMA ring and line framing, then dropped unparsed
+static void op_uart_rx(uint32_t i) {
+    (void)i;
+    hal_shim_uart_rx(cmd_bytes, cmd_len);
+    while (rx_next_line()) rx_line_done();
+    loop_event[EVT_RX] = 0;
+}
+
+// The same bytes followed by parsing and running the command
+static void op_command(uint32_t i) {
+    (void)i;
+    hal_shim_uart_rx(cmd_bytes, cmd_len);
+    handle_commands();
+    loop_event[EVT_RX] = 0;
+    drain();
+}
+
+// =============== STORM / LOGGING ===============
+static void setup_fresh(uint32_t arg) {
+    (void)arg;
+    fresh_state();
+}
+
+static void setup_binary(uint32_t arg) {
+    (void)arg;
+    fresh_state();
+    cmd_proto(PROTO_BINARY);
+    drain();
+}
+
+static void op_storm(uint32_t i) {
+    int16_t x, y;
+    hal_shim_set_tick(i * 7);
+    get_storm_offsets(&x, &y);
+    sink += x + y;
+}
+
+static void op_log(uint32_t i) {
+    log_to_buffer("RESULT:MISS,%d,%d", (int)(i & 511), (int)(i & 255));
+    drain();
+}
+
+static void op_emit_ship(uint32_t i) {
+    emit_event(EV_SHIP, 20, (int16_t)(i & 511), (int16_t)(i & 255));
+    drain();
+}
+
+// =============== RUNNER ===============
+static const BenchCase cases[] = {
+    { "check_ship_hit/miss/uniform/1",   setup_miss_uniform, op_shot_miss, 1 },
+    { "check_ship_hit/miss/uniform/8",   setup_miss_uniform, op_shot_miss, 8 },
+    { "check_ship_hit/miss/uniform/25",  setup_miss_uniform, op_shot_miss, 25 },
+    { "check_ship_hit/miss/uniform/64",  setup_miss_uniform, op_shot_miss, 64 },
+    { "check_ship_hit/miss/uniform/256", setup_miss_uniform, op_shot_miss, 256 },
+    { "check_ship_hit/miss/cluster/8",   setup_miss_cluster, op_shot_miss, 8 },
+    { "check_ship_hit/miss/cluster/25",  setup_miss_cluster, op_shot_miss, 25 },
+    { "check_ship_hit/miss/cluster/64",  setup_miss_cluster, op_shot_miss, 64 },
+    { "check_ship_hit/hit/uniform/25",   setup_hit_uniform,  op_shot_hit,  25 },
+    { "check_ship_hit/hit/uniform/256",  setup_hit_uniform,  op_shot_hit,  256 },
+    { "check_ship_hit/hit/cluster/25",   setup_hit_cluster,  op_shot_hit,  25 },
+    { "check_ship_hit/hit/cluster/64",   setup_hit_cluster,  op_shot_hit,  64 },
+    { "spawn_ship",                      setup_spawn,        op_spawn,     0 },
+    { "uart_rx/shot",                    setup_text_cmd,     op_uart_rx,   0 },
+    { "uart_rx/bin_shot",                setup_bin_shot,     op_uart_rx,   0 },
+    { "handle_commands/shot",            setup_text_cmd,     op_command,   0 },
+    { "handle_commands/storm_update",    setup_text_cmd,     op_command,   1 },
+    { "handle_commands/ping",            setup_text_cmd,     op_command,   2 },
+    { "handle_commands/unknown",         setup_text_cmd,     op_command,   3 },
+    { "handle_commands/bad_arg",         setup_text_cmd,     op_command,   4 },
+    { "handle_commands/bin_shot",        setup_bin_shot,     op_command,   0 },
+    { "get_storm_offsets",               setup_fresh,        op_storm,     0 },
+    { "log_to_buffer/ascii",             setup_fresh,        op_log,       0 },
+    { "log_to_buffer/binary",            setup_binary,       op_log,       0 },
+    { "emit_event/ship/ascii",           setup_fresh,        op_emit_ship, 0 },
+    { "emit_event/ship/binary",          setup_binary,       op_emit_ship, 0 },
+};
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void run_case(const BenchCase *c) {
+    c->setup(c->arg);
+
+    // Grow the batch until one run lasts min_time
+    uint32_t ops = 64;
+    for (;;) {
+        uint64_t t0 = now_ns();
+        for (uint32_t i = 0; i < ops; i++) c->op(i);
+        double ms = (now_ns() - t0) / 1e6;
+        if (ms >= min_time_ms || ops >= (1u << 30)) break;
+        double scale = (ms > 0) ? min_time_ms * 1.2 / ms : 100.0;
+        ops = (scale > 100.0) ? ops * 100 : (uint32_t)(ops * scale) + 1;
+    }
+
+    double ns[BENCH_REPEATS];
+    uint64_t allocs = 0;
+    for (int r = 0; r < BENCH_REPEATS; r++) {
+        c->setup(c->arg);
+        uint64_t a0 = alloc_count;
+        uint64_t t0 = now_ns();
+        for (uint32_t i = 0; i < ops; i++) c->op(i);
+        ns[r] = (double)(now_ns() - t0) / ops;
+        allocs += alloc_count - a0;
+    }
+    qsort(ns, BENCH_REPEATS, sizeof(ns[0]), cmp_double);
+    printf("%s,%.1f,%.3f,%lu\n", c->name, ns[BENCH_REPEATS / 2],
+           (double)allocs / ((double)ops * BENCH_REPEATS), (unsigned long)ops);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--filter") == 0) {
+            filter = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--min-time") == 0) {
+            min_time_ms = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: fw_bench [--filter TEXT] [--min-time MS]\n");
+            return 2;
+        }
+    }
+
+    app_init();
+    drain();
+
+    struct utsname u;
+    uname(&u);
+    printf("# fw_bench host=%s/%s target_clock_hz=%lu max_ships=%d\n",
+           u.sysname, u.machine, (unsigned long)SystemCoreClock, MAX_SHIPS);
+    printf("name,ns_per_op,allocs_per_op,ops\n");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (filter && !strstr(cases[i].name, filter)) continue;
+        run_case(&cases[i]);
+    }
+    return 0;
+}
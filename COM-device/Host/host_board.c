@@ -0,0 +1,79 @@
+/**
+  ******************************************************************************
+  * @file    host_board.c
+  * @brief   Host versions of the board-specific pieces that stay in main.c
+  *          on the target: the main loop, the entropy source, CMD:STATUS.
+  ******************************************************************************
+  */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host_board.h"
+#include "app.h"
+#include "comm.h"
+#include "game.h"
+
+// Set by the firmware modules and the shim callbacks, taken by the host loop
+volatile uint8_t loop_event[EVT_COUNT] = {0, 0, 0, 1};
+static uint32_t loop_deadline = 0;
+
+static uint32_t status_since = 0;
+static uint32_t entropy_calls = 0;
+
+static uint8_t event_take(LoopEvent ev) {
+    if (!loop_event[ev]) return 0;
+    loop_event[ev] = 0;
+    return 1;
+}
+
+uint8_t host_events_pending(void) {
+    for (int i = 0; i < EVT_COUNT; i++) {
+        if (loop_event[i]) return 1;
+    }
+    return 0;
+}
+
+// The body of main()'s loop at a given tick: passes run while events are
+// raised, as the board would leave loop_sleep() for each of them. A deadline
+// already due moves to the next tick; the board would spin until then.
+uint32_t host_loop_step(uint32_t tick) {
+    hal_shim_set_tick(tick);
+    if ((int32_t)(tick - loop_deadline) >= 0) {
+        loop_event[EVT_TIMER] = 1;
+    }
+    while (host_events_pending()) {
+        uint8_t rx = event_take(EVT_RX);
+        uint8_t button = event_take(EVT_BUTTON);
+        uint8_t timer = event_take(EVT_TIMER);
+        event_take(EVT_TX);
+        app_pass(tick, rx, button, timer);
+        loop_deadline = loop_next_deadline(tick);
+        if ((int32_t)(tick - loop_deadline) >= 0) {
+            loop_deadline = tick + 1;
+        }
+    }
+    return loop_deadline;
+}
+
+// No hardware noise on the host: derived from the virtual tick and a call
+// counter, so a host run is repeatable even without CMD:SEED
+uint32_t rng_entropy(void) {
+    uint32_t e = HAL_GetTick() ^ (++entropy_calls * 0x9E3779B9u);
+    e ^= e >> 15;
+    e *= 0x2C1B3C6Du;
+    e ^= e >> 12;
+    return e & INT32_MAX;
+}
+
+// The host never sleeps, so the idle share is always zero
+void cmd_status(void) {
+    uint32_t now = HAL_GetTick();
+    log_to_buffer("STATUS:IDLE:0,0,%lu", (unsigned long)(now - status_since));
+    status_since = now;
+}
+
+// On the board a failed HAL call is survivable; here it is a bug to report
+void Error_Handler(void) {
+    fprintf(stderr, "Error_Handler() called\n");
+    abort();
+}
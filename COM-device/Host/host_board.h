@@ -0,0 +1,26 @@
+/**
+  ******************************************************************************
+  * @file    host_board.h
+  * @brief   Host side of the board: drives the firmware main loop for the
+  *          host programs built with CMakeLists.txt.
+  ******************************************************************************
+  */
+#ifndef __HOST_BOARD_H__
+#define __HOST_BOARD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+// Runs the passes main() would run at tick; returns the tick of the next
+// time-driven wake-up
+uint32_t host_loop_step(uint32_t tick);
+uint8_t host_events_pending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_BOARD_H__ */
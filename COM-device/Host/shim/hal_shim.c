@@ -0,0 +1,202 @@
+/**
+  ******************************************************************************
+  * @file    hal_shim.c
+  * @brief   Host stand-in for the HAL calls and CubeMX handles the portable
+  *          firmware modules use. UART DMA transfers stay pending until the
+  *          host completes them, received bytes go through the same circular
+  *          buffer and RX events as on the board.
+  ******************************************************************************
+  */
+#include "main.h"
+#include "tim.h"
+#include "usart.h"
+
+// =============== PERIPHERALS ===============
+DWT_Type hal_shim_dwt;
+CoreDebug_Type hal_shim_coredebug;
+RCC_TypeDef hal_shim_rcc = { .CFGR = RCC_CFGR_PPRE1_DIV2 };     // as SystemClock_Config
+GPIO_TypeDef hal_shim_gpioa;
+GPIO_TypeDef hal_shim_gpiob;
+TIM_TypeDef hal_shim_tim2;
+TIM_TypeDef hal_shim_tim3;
+USART_TypeDef hal_shim_usart2;
+static DMA_Channel_TypeDef dma1_channel3;
+static DMA_Channel_TypeDef dma1_channel6;
+static DMA_Channel_TypeDef dma1_channel7;
+
+uint32_t SystemCoreClock = 64000000;
+
+// =============== HANDLES ===============
+DMA_HandleTypeDef hdma_usart2_rx = { .Instance = &dma1_channel6, .State = HAL_DMA_STATE_READY };
+DMA_HandleTypeDef hdma_usart2_tx = { .Instance = &dma1_channel7, .State = HAL_DMA_STATE_READY };
+DMA_HandleTypeDef hdma_tim3_up = { .Instance = &dma1_channel3, .State = HAL_DMA_STATE_READY };
+UART_HandleTypeDef huart2 = {
+    .Instance = USART2,
+    .Init = { .BaudRate = 115200 },
+    .hdmatx = &hdma_usart2_tx,
+    .hdmarx = &hdma_usart2_rx,
+};
+TIM_HandleTypeDef htim2 = { .Instance = TIM2, .Init = { .Prescaler = 319, .Period = 99 } };
+TIM_HandleTypeDef htim3 = { .Instance = TIM3 };
+
+void MX_TIM3_DisplayDMA_Init(uint32_t word_rate_hz) {
+    htim3.Init.Period = SystemCoreClock / word_rate_hz - 1;
+    htim3.Instance->ARR = htim3.Init.Period;
+}
+
+// =============== TICK ===============
+static volatile uint32_t uwTick = 0;
+
+uint32_t HAL_GetTick(void) {
+    return uwTick;
+}
+
+void HAL_IncTick(void) {
+    uwTick++;
+}
+
+void hal_shim_set_tick(uint32_t tick) {
+    uwTick = tick;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) {
+    return SystemCoreClock / 2;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn) {
+    (void)IRQn;
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn) {
+    (void)IRQn;
+}
+
+// =============== GPIO ===============
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+    if (PinState != GPIO_PIN_RESET) {
+        GPIOx->ODR |= GPIO_Pin;
+    } else {
+        GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+    }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin) {
+    return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+// =============== DMA / TIM ===============
+// Memory-to-peripheral transfers end at once: nothing on the host watches the pins
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uint32_t SrcAddress,
+                                   uint32_t DstAddress, uint32_t DataLength) {
+    (void)SrcAddress;
+    (void)DstAddress;
+    (void)DataLength;
+    if (hdma->XferCpltCallback) {
+        hdma->XferCpltCallback(hdma);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma) {
+    hdma->State = HAL_DMA_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim) {
+    __HAL_TIM_ENABLE(htim);
+    return HAL_OK;
+}
+
+// =============== UART ===============
+static const uint8_t *uart_tx_data = NULL;
+static uint16_t uart_tx_len = 0;
+static uint8_t *uart_rx_buf = NULL;
+static uint16_t uart_rx_size = 0;
+static uint16_t uart_rx_pos = 0;
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart) {
+    (void)huart;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size) {
+    (void)huart;
+    if (uart_tx_len != 0) return HAL_BUSY;
+    if (pData == NULL || Size == 0) return HAL_ERROR;
+    uart_tx_data = pData;
+    uart_tx_len = Size;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size) {
+    if (pData == NULL || Size == 0) return HAL_ERROR;
+    uart_rx_buf = pData;
+    uart_rx_size = Size;
+    uart_rx_pos = 0;
+    huart->hdmarx->Instance->CNDTR = Size;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef *huart) {
+    (void)huart;
+    uart_tx_data = NULL;
+    uart_tx_len = 0;
+    uart_rx_buf = NULL;
+    return HAL_OK;
+}
+
+uint32_t hal_shim_uart_flags(const UART_HandleTypeDef *huart) {
+    (void)huart;
+    return uart_tx_len ? 0 : UART_FLAG_TC;
+}
+
+uint16_t hal_shim_uart_tx_pending(const uint8_t **data) {
+    if (data) *data = uart_tx_data;
+    return uart_tx_len;
+}
+
+void hal_shim_uart_tx_done(void) {
+    if (uart_tx_len == 0) return;
+    uart_tx_data = NULL;
+    uart_tx_len = 0;
+    HAL_UART_TxCpltCallback(&huart2);
+}
+
+uint32_t hal_shim_uart_flush(void (*sink)(const uint8_t *data, uint16_t len, void *ctx), void *ctx) {
+    uint32_t total = 0;
+    const uint8_t *data;
+    uint16_t len;
+    while ((len = hal_shim_uart_tx_pending(&data)) != 0) {
+        if (sink) sink(data, len, ctx);
+        total += len;
+        hal_shim_uart_tx_done();
+    }
+    return total;
+}
+
+// Circular mode: the counter reloads at the end of the buffer, HAL reports
+// the half and full marks and an idle line after the last byte
+void hal_shim_uart_rx(const uint8_t *data, uint32_t len) {
+    DMA_Channel_TypeDef *ch = huart2.hdmarx->Instance;
+    uint8_t idle = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        if (uart_rx_buf == NULL) return;        // reception aborted
+        uart_rx_buf[uart_rx_pos++] = data[i];
+        idle = 1;
+        if (uart_rx_pos == uart_rx_size) {
+            uart_rx_pos = 0;
+            ch->CNDTR = uart_rx_size;
+            idle = 0;
+            HAL_UARTEx_RxEventCallback(&huart2, uart_rx_size);
+        } else {
+            ch->CNDTR = uart_rx_size - uart_rx_pos;
+            if (uart_rx_pos == uart_rx_size / 2) {
+                idle = 0;
+                HAL_UARTEx_RxEventCallback(&huart2, uart_rx_pos);
+            }
+        }
+    }
+    if (idle) {
+        HAL_UARTEx_RxEventCallback(&huart2, uart_rx_pos);
+    }
+}
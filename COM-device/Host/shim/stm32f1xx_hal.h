@@ -0,0 +1,248 @@
+/**
+  ******************************************************************************
+  * @file    stm32f1xx_hal.h
+  * @brief   Host stand-in for the STM32F1 HAL. Only the handles, registers
+  *          and calls used by the portable firmware modules are provided;
+  *          peripherals are plain structs and time is a virtual tick.
+  *
+  *          It shadows the real header when Host/shim comes first on the
+  *          include path, so Core/Inc/main.h is used unchanged.
+  ******************************************************************************
+  */
+#ifndef __STM32F1xx_HAL_H
+#define __STM32F1xx_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define __IO                    volatile
+
+typedef enum {
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum {
+    EXTI0_IRQn = 6,
+    EXTI1_IRQn = 7,
+    EXTI4_IRQn = 10,
+    TIM2_IRQn = 28,
+    USART2_IRQn = 38
+} IRQn_Type;
+
+// =============== CORE ===============
+typedef struct {
+    __IO uint32_t CTRL;
+    __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+#define DWT_CTRL_CYCCNTENA_Msk          (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk      (1UL << 24)
+
+extern DWT_Type hal_shim_dwt;
+extern CoreDebug_Type hal_shim_coredebug;
+#define DWT                     (&hal_shim_dwt)
+#define CoreDebug               (&hal_shim_coredebug)
+
+extern uint32_t SystemCoreClock;
+
+// The host is single threaded: interrupts are the shim calls below, which
+// never run in the middle of firmware code
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __set_PRIMASK(uint32_t primask) { (void)primask; }
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline uint32_t __RBIT(uint32_t v) {
+    v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+    v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+    v = ((v >> 4) & 0x0F0F0F0Fu) | ((v & 0x0F0F0F0Fu) << 4);
+    v = ((v >> 8) & 0x00FF00FFu) | ((v & 0x00FF00FFu) << 8);
+    return (v >> 16) | (v << 16);
+}
+static inline uint8_t __CLZ(uint32_t v) { return v ? (uint8_t)__builtin_clz(v) : 32; }
+
+// =============== RCC ===============
+typedef struct {
+    __IO uint32_t CFGR;
+} RCC_TypeDef;
+
+#define RCC_CFGR_PPRE1          (0x7UL << 8)
+#define RCC_CFGR_PPRE1_DIV1     (0x0UL << 8)
+#define RCC_CFGR_PPRE1_DIV2     (0x4UL << 8)
+
+extern RCC_TypeDef hal_shim_rcc;
+#define RCC                     (&hal_shim_rcc)
+
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+
+// =============== GPIO ===============
+typedef struct {
+    __IO uint32_t CRL;
+    __IO uint32_t CRH;
+    __IO uint32_t IDR;
+    __IO uint32_t ODR;
+    __IO uint32_t BSRR;
+    __IO uint32_t BRR;
+    __IO uint32_t LCKR;
+} GPIO_TypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+#define GPIO_PIN_0              ((uint16_t)0x0001)
+#define GPIO_PIN_1              ((uint16_t)0x0002)
+#define GPIO_PIN_2              ((uint16_t)0x0004)
+#define GPIO_PIN_3              ((uint16_t)0x0008)
+#define GPIO_PIN_4              ((uint16_t)0x0010)
+#define GPIO_PIN_5              ((uint16_t)0x0020)
+#define GPIO_PIN_8              ((uint16_t)0x0100)
+#define GPIO_PIN_9              ((uint16_t)0x0200)
+
+extern GPIO_TypeDef hal_shim_gpioa;
+extern GPIO_TypeDef hal_shim_gpiob;
+#define GPIOA                   (&hal_shim_gpioa)
+#define GPIOB                   (&hal_shim_gpiob)
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+// =============== DMA ===============
+typedef struct {
+    __IO uint32_t CCR;
+    __IO uint32_t CNDTR;
+    __IO uint32_t CPAR;
+    __IO uint32_t CMAR;
+} DMA_Channel_TypeDef;
+
+typedef enum {
+    HAL_DMA_STATE_RESET = 0x00U,
+    HAL_DMA_STATE_READY = 0x01U,
+    HAL_DMA_STATE_BUSY = 0x02U
+} HAL_DMA_StateTypeDef;
+
+typedef struct __DMA_HandleTypeDef {
+    DMA_Channel_TypeDef *Instance;
+    __IO HAL_DMA_StateTypeDef State;
+    void (*XferCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+    void (*XferErrorCallback)(struct __DMA_HandleTypeDef *hdma);
+} DMA_HandleTypeDef;
+
+#define __HAL_DMA_GET_COUNTER(__HANDLE__)   ((__HANDLE__)->Instance->CNDTR)
+
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uint32_t SrcAddress,
+                                   uint32_t DstAddress, uint32_t DataLength);
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma);
+
+// =============== TIM ===============
+typedef struct {
+    __IO uint32_t CR1;
+    __IO uint32_t CNT;
+    __IO uint32_t PSC;
+    __IO uint32_t ARR;
+} TIM_TypeDef;
+
+typedef struct {
+    uint32_t Prescaler;
+    uint32_t Period;
+} TIM_Base_InitTypeDef;
+
+typedef struct {
+    TIM_TypeDef *Instance;
+    TIM_Base_InitTypeDef Init;
+} TIM_HandleTypeDef;
+
+#define TIM_CR1_CEN             (1UL << 0)
+
+extern TIM_TypeDef hal_shim_tim2;
+extern TIM_TypeDef hal_shim_tim3;
+#define TIM2                    (&hal_shim_tim2)
+#define TIM3                    (&hal_shim_tim3)
+
+#define __HAL_TIM_ENABLE(__HANDLE__)        ((__HANDLE__)->Instance->CR1 |= TIM_CR1_CEN)
+#define __HAL_TIM_DISABLE(__HANDLE__)       ((__HANDLE__)->Instance->CR1 &= ~TIM_CR1_CEN)
+#define __HAL_TIM_SET_COUNTER(__HANDLE__, __COUNTER__) \
+    ((__HANDLE__)->Instance->CNT = (__COUNTER__))
+#define __HAL_TIM_SET_AUTORELOAD(__HANDLE__, __AUTORELOAD__) \
+    do { \
+        (__HANDLE__)->Instance->ARR = (__AUTORELOAD__); \
+        (__HANDLE__)->Init.Period = (__AUTORELOAD__); \
+    } while (0)
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+
+// =============== UART ===============
+typedef struct {
+    uint32_t dummy;
+} USART_TypeDef;
+
+typedef struct {
+    uint32_t BaudRate;
+} UART_InitTypeDef;
+
+typedef struct {
+    USART_TypeDef *Instance;
+    UART_InitTypeDef Init;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+} UART_HandleTypeDef;
+
+#define UART_FLAG_TC            (1UL << 6)
+
+extern USART_TypeDef hal_shim_usart2;
+#define USART2                  (&hal_shim_usart2)
+
+#define __HAL_UART_GET_FLAG(__HANDLE__, __FLAG__)   (hal_shim_uart_flags(__HANDLE__) & (__FLAG__))
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef *huart);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size);
+
+// =============== NVIC / TICK ===============
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+
+uint32_t HAL_GetTick(void);
+void HAL_IncTick(void);
+
+// =============== HOST SIDE ===============
+// What the hardware would do on its own, driven by the host program.
+
+// Virtual millisecond tick
+void hal_shim_set_tick(uint32_t tick);
+
+// The transfer started by HAL_UART_Transmit_DMA and not yet completed:
+// returns its length (0 when idle) and points *data at the bytes
+uint16_t hal_shim_uart_tx_pending(const uint8_t **data);
+// Ends the pending transfer and runs HAL_UART_TxCpltCallback, which may
+// start the next one
+void hal_shim_uart_tx_done(void);
+// Completes transfers until the firmware has nothing left to send, passing
+// every one to sink (which may be NULL); returns the bytes sent
+uint32_t hal_shim_uart_flush(void (*sink)(const uint8_t *data, uint16_t len, void *ctx), void *ctx);
+// Bytes arriving on the RX pin: stored in the circular DMA buffer with the
+// half, full and idle-line events of the real channel
+void hal_shim_uart_rx(const uint8_t *data, uint32_t len);
+uint32_t hal_shim_uart_flags(const UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32F1xx_HAL_H */
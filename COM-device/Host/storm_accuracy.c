@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file    storm_accuracy.c
+  * @brief   Host-side check of the fixed-point storm generator against the
+  *          float sinf() version it replaced.
+  *
+  *          Built as the storm_accuracy target of the CMake host build, or
+  *          gcc -O2 -I../Core/Inc storm_accuracy.c ../Core/Src/storm.c -lm
+  *
+  *          Exits non-zero if the sine error exceeds 2 LSB of Q15 or any
+  *          offset differs from the float one by more than a pixel.
+  ******************************************************************************
+  */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "storm.h"
+
+#define SIN_MAX_ERR_LSB     2
+#define OFFSET_MAX_ERR_PX   1
+
+// The original float generator, kept verbatim for comparison
+static void storm_offsets_float(const StormParams *p, uint32_t t, int16_t *out_x, int16_t *out_y) {
+    float period_x = p->period_x_ms;
+    float period_y = p->period_y_ms;
+    float phase_x = 2.0f * 3.14159265f * (t % (uint32_t)period_x) / period_x;
+    float phase_y = 2.0f * 3.14159265f * (t % (uint32_t)period_y) / period_y;
+    *out_x = (int16_t)(p->amp_x * sinf(phase_x));
+    *out_y = (int16_t)(p->amp_y * sinf(phase_y + p->phase_y_mrad / 1000.0f));
+}
+
+static int check_sine(void) {
+    double max_err = 0.0;
+    uint32_t worst = 0;
+    for (uint32_t a = 0; a < STORM_ANGLE_TURN; a++) {
+        double ref = 32767.0 * sin(2.0 * M_PI * a / STORM_ANGLE_TURN);
+        double err = fabs(storm_sin_q15((uint16_t)a) - ref);
+        if (err > max_err) {
+            max_err = err;
+            worst = a;
+        }
+    }
+    printf("sin_q15: max error %.3f LSB at angle %lu\n", max_err, (unsigned long)worst);
+    return max_err <= SIN_MAX_ERR_LSB;
+}
+
+static int check_offsets(const StormParams *p, uint32_t ticks) {
+    uint32_t mismatches = 0;
+    int worst = 0;
+    for (uint32_t t = 0; t < ticks; t++) {
+        int16_t fx, fy, qx, qy;
+        storm_offsets_float(p, t, &fx, &fy);
+        storm_offsets(p, t, &qx, &qy);
+        int dx = abs(fx - qx);
+        int dy = abs(fy - qy);
+        if (dx || dy) mismatches++;
+        if (dx > worst) worst = dx;
+        if (dy > worst) worst = dy;
+    }
+    printf("amp %d,%d period %u,%u: %lu/%lu samples differ, max %d px\n",
+           p->amp_x, p->amp_y, p->period_x_ms, p->period_y_ms,
+           (unsigned long)mismatches, (unsigned long)ticks, worst);
+    return worst <= OFFSET_MAX_ERR_PX;
+}
+
+int main(void) {
+    int ok = check_sine();
+    for (int16_t amp = 0; amp <= 50; amp += 5) {
+        StormParams p = { amp, amp, 2400, 1900, 700 };
+        // One full common period of both axes
+        ok &= check_offsets(&p, 2400u * 1900u / 100u);
+    }
+    puts(ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
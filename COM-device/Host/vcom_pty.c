@@ -0,0 +1,291 @@
+/**
+  ******************************************************************************
+  * @file    vcom_pty.c
+  * @brief   Virtual COM device: the firmware runs in real time behind a
+  *          pseudo-terminal, so the browser side can be developed and
+  *          load-tested without a board.
+  *
+  *          vcom_pty [--link PATH] [--baud B] [--latency MS] [--jitter MS]
+  *                   [--loss P] [--seed S]
+  *
+  *          The slave side (/dev/pts/N, or PATH as a symlink to it) is the
+  *          serial port. Both directions are paced at the firmware's current
+  *          UART rate, or at --baud B (0 = unlimited), 10 bits per byte.
+  *          --latency adds a one-way delay, --jitter up to that many extra
+  *          ms per byte (order is kept), --loss drops each byte with
+  *          probability P. --seed makes the impairments repeatable.
+  *          Counters are printed to stderr on SIGINT/SIGTERM.
+  ******************************************************************************
+  */
+#define _GNU_SOURCE
+// Before <termios.h>, whose CR1 macro would clash with the shim's TIM_TypeDef
+#include "host_board.h"
+#include "app.h"
+#include "usart.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LINK_QUEUE_SIZE         65536   // bytes in flight per direction, power of two
+#define RX_BATCH_SIZE           256
+
+typedef struct {
+    uint64_t at[LINK_QUEUE_SIZE];       // delivery time, microseconds
+    uint8_t data[LINK_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    uint64_t wire_free;                 // when the wire is free for the next byte
+    uint64_t last_at;
+    uint64_t bytes;
+    uint64_t lost;
+    uint64_t overflow;
+} Link;
+
+typedef struct {
+    const char *link_path;
+    long baud;                          // -1 follows the firmware
+    uint32_t latency_us;
+    uint32_t jitter_us;
+    double loss;
+    uint64_t seed;
+} PtyOptions;
+
+static PtyOptions opt = { NULL, -1, 0, 0, 0.0, 0 };
+static Link to_device;
+static Link to_host;
+static uint64_t host_write_drops = 0;
+static volatile sig_atomic_t stop = 0;
+static uint64_t rng_state;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// xorshift64*: impairments only, kept apart from the game's generator
+static uint64_t imp_next(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double imp_uniform(void) {
+    return (imp_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint32_t byte_time_us(void) {
+    long baud = (opt.baud >= 0) ? opt.baud : (long)huart2.Init.BaudRate;
+    return baud > 0 ? (uint32_t)((10 * 1000000UL + baud - 1) / baud) : 0;
+}
+
+// =============== LINK ===============
+// A byte enters the wire once the previous one has left it and arrives
+// latency + jitter later, never ahead of the byte before it
+static void link_push(Link *l, uint8_t b, uint64_t now) {
+    uint64_t start = (l->wire_free > now) ? l->wire_free : now;
+    l->wire_free = start + byte_time_us();
+    if (opt.loss > 0 && imp_uniform() < opt.loss) {
+        l->lost++;
+        return;
+    }
+    if (l->head - l->tail == LINK_QUEUE_SIZE) {
+        l->overflow++;
+        return;
+    }
+    uint64_t at = l->wire_free + opt.latency_us;
+    if (opt.jitter_us) at += imp_next() % (opt.jitter_us + 1);
+    if (at < l->last_at) at = l->last_at;
+    l->last_at = at;
+    uint32_t i = l->head++ & (LINK_QUEUE_SIZE - 1);
+    l->at[i] = at;
+    l->data[i] = b;
+    l->bytes++;
+}
+
+static uint8_t link_due(const Link *l, uint64_t now) {
+    return l->head != l->tail && l->at[l->tail & (LINK_QUEUE_SIZE - 1)] <= now;
+}
+
+static uint64_t link_next(const Link *l) {
+    return (l->head != l->tail) ? l->at[l->tail & (LINK_QUEUE_SIZE - 1)] : UINT64_MAX;
+}
+
+static uint8_t link_pop(Link *l) {
+    return l->data[l->tail++ & (LINK_QUEUE_SIZE - 1)];
+}
+
+// =============== PTY ===============
+static int pty_open(void) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("vcom_pty: posix_openpt");
+        exit(1);
+    }
+    const char *name = ptsname(master);
+    // Holding the slave open keeps the master readable between clients
+    int slave = open(name, O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        perror("vcom_pty: open slave");
+        exit(1);
+    }
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    fprintf(stderr, "vcom_pty: %s\n", name);
+    if (opt.link_path) {
+        unlink(opt.link_path);
+        if (symlink(name, opt.link_path) != 0) {
+            perror("vcom_pty: symlink");
+            exit(1);
+        }
+        fprintf(stderr, "vcom_pty: %s -> %s\n", opt.link_path, name);
+    }
+    return master;
+}
+
+static void pty_read(int fd, uint64_t now) {
+    uint8_t buf[RX_BATCH_SIZE];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; i++) link_push(&to_device, buf[i], now);
+    }
+}
+
+static void pty_write(int fd, uint64_t now) {
+    uint8_t buf[RX_BATCH_SIZE];
+    while (link_due(&to_host, now)) {
+        size_t n = 0;
+        while (n < sizeof(buf) && link_due(&to_host, now)) buf[n++] = link_pop(&to_host);
+        ssize_t written = write(fd, buf, n);
+        if (written == (ssize_t)n) continue;
+        // Nobody reading and the pty buffer full: the bytes are gone, as on a real line
+        host_write_drops += (written >= 0) ? n - (size_t)written : n;
+        if (written < 0 && errno == EAGAIN) {
+            // No point retrying until the next pass; what is due now is lost too
+            while (link_due(&to_host, now)) {
+                link_pop(&to_host);
+                host_write_drops++;
+            }
+            return;
+        }
+    }
+}
+
+// =============== DEVICE ===============
+static uint64_t tx_end = UINT64_MAX;
+
+static void device_rx(uint64_t now) {
+    uint8_t buf[RX_BATCH_SIZE];
+    while (link_due(&to_device, now)) {
+        uint32_t n = 0;
+        while (n < sizeof(buf) && link_due(&to_device, now)) buf[n++] = link_pop(&to_device);
+        hal_shim_uart_rx(buf, n);
+    }
+}
+
+// A DMA transfer goes on the wire when it starts and ends when its last
+// byte has left the shift register
+static void device_tx(uint64_t now) {
+    const uint8_t *data;
+    uint16_t len = hal_shim_uart_tx_pending(&data);
+    if (len && tx_end == UINT64_MAX) {
+        for (uint16_t i = 0; i < len; i++) link_push(&to_host, data[i], now);
+        tx_end = to_host.wire_free;
+    }
+    if (len && tx_end <= now) {
+        tx_end = UINT64_MAX;
+        hal_shim_uart_tx_done();
+    }
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: vcom_pty [--link PATH] [--baud B] [--latency MS] [--jitter MS] "
+                    "[--loss P] [--seed S]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    opt.seed = (uint64_t)time(NULL);
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) usage();
+        const char *a = argv[i], *v = argv[++i];
+        if (strcmp(a, "--link") == 0) {
+            opt.link_path = v;
+        } else if (strcmp(a, "--baud") == 0) {
+            opt.baud = strtol(v, NULL, 10);
+        } else if (strcmp(a, "--latency") == 0) {
+            opt.latency_us = (uint32_t)(atof(v) * 1000);
+        } else if (strcmp(a, "--jitter") == 0) {
+            opt.jitter_us = (uint32_t)(atof(v) * 1000);
+        } else if (strcmp(a, "--loss") == 0) {
+            opt.loss = atof(v);
+        } else if (strcmp(a, "--seed") == 0) {
+            opt.seed = strtoull(v, NULL, 10);
+        } else {
+            usage();
+        }
+    }
+    if (opt.baud < -1 || opt.loss < 0 || opt.loss > 1) usage();
+    rng_state = opt.seed ? opt.seed : 1;
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+    int fd = pty_open();
+
+    uint64_t start = now_us();
+    hal_shim_set_tick(0);
+    app_init();
+
+    while (!stop) {
+        uint64_t now = now_us() - start;
+        uint32_t tick = (uint32_t)(now / 1000);
+
+        pty_read(fd, now);
+        device_rx(now);
+        device_tx(now);
+        uint32_t deadline = host_loop_step(tick);
+        device_tx(now);
+        pty_write(fd, now);
+
+        uint64_t next = (uint64_t)deadline * 1000;
+        if (tx_end < next) next = tx_end;
+        if (link_next(&to_device) < next) next = link_next(&to_device);
+        if (link_next(&to_host) < next) next = link_next(&to_host);
+
+        int timeout = 0;
+        if (next > now) {
+            uint64_t ms = (next - now + 999) / 1000;
+            timeout = (ms > 1000) ? 1000 : (int)ms;
+        }
+        struct pollfd p = { fd, POLLIN, 0 };
+        poll(&p, 1, timeout);
+    }
+
+    if (opt.link_path) unlink(opt.link_path);
+    fprintf(stderr, "vcom_pty: to device %llu bytes, %llu lost, %llu overflow; "
+                    "to host %llu bytes, %llu lost, %llu overflow, %llu unread\n",
+            (unsigned long long)to_device.bytes, (unsigned long long)to_device.lost,
+            (unsigned long long)to_device.overflow, (unsigned long long)to_host.bytes,
+            (unsigned long long)to_host.lost, (unsigned long long)to_host.overflow,
+            (unsigned long long)host_write_drops);
+    return 0;
+}
@@ -1,3 +1,96 @@
+// Бинарный протокол: COBS-кадр с CRC-16/CCITT-FALSE (little-endian) в конце,
+// кадры разделяются байтом 0x00. Типы совпадают с MSG_* в COM-device/Core/Inc/comm.h
+const MSG = Object.freeze({
+    TIME: 0x01,
+    SHIP: 0x02,
+    HIT: 0x03,
+    MISS: 0x04,
+    STORM: 0x05,
+    TICK: 0x06,
+    STORM_PARAM: 0x07,
+    STORM_SYNC: 0x08,
+    REL: 0x09,
+    ACK: 0x0A,
+    TEXT: 0x7F,
+    CMD_START: 0x81,
+    CMD_PAUSE: 0x82,
+    CMD_RESET: 0x83,
+    CMD_SHOT: 0x84,
+    CMD_STORM_UPDATE: 0x85,
+    CMD_PROTO: 0x86,
+    CMD_REL: 0x87,
+    CMD_ACK: 0x88
+});
+
+// Метка времени платы в конце текстового сообщения: <сообщение>@<тик>
+const TIMESTAMP_SUFFIX = /@(\d+)$/;
+const EVENT_NAME = /^(?:R:\d+:)?([A-Z_]+)/;
+
+const CRC16_TABLE = (() => {
+    const table = new Uint16Array(256);
+    for (let i = 0; i < 256; i++) {
+        let crc = i << 8;
+        for (let bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+        table[i] = crc & 0xFFFF;
+    }
+    return table;
+})();
+
+function crc16(bytes, start, end) {
+    let crc = 0xFFFF;
+    for (let i = start; i < end; i++) {
+        crc = ((crc << 8) ^ CRC16_TABLE[((crc >> 8) ^ bytes[i]) & 0xFF]) & 0xFFFF;
+    }
+    return crc;
+}
+
+// Декодирует COBS из src[start..end) в dst, возвращает длину или -1
+function cobsDecode(src, start, end, dst) {
+    let read = start;
+    let write = 0;
+    while (read < end) {
+        const code = src[read++];
+        if (code === 0) return -1;
+        for (let i = 1; i < code; i++) {
+            if (read >= end || write >= dst.length) return -1;
+            dst[write++] = src[read++];
+        }
+        if (code !== 0xFF && read < end) {
+            if (write >= dst.length) return -1;
+            dst[write++] = 0;
+        }
+    }
+    return write;
+}
+
+// Кодирует src[0..len) в COBS между двумя разделителями 0x00: по первому
+// плата отличает кадр от текстовой строки (см. rx_feed_byte в comm.c)
+function cobsEncode(src, len) {
+    const out = new Uint8Array(len + Math.ceil(len / 254) + 3);
+    let write = 2;
+    let codePos = 1;
+    let code = 1;
+    for (let read = 0; read < len; read++) {
+        if (src[read] === 0) {
+            out[codePos] = code;
+            code = 1;
+            codePos = write++;
+        } else {
+            out[write++] = src[read];
+            if (++code === 0xFF) {
+                out[codePos] = code;
+                code = 1;
+                codePos = write++;
+            }
+        }
+    }
+    out[codePos] = code;
+    out[write++] = 0;
+    return out.subarray(0, write);
+}
+
 class COMInterface {
     constructor(game, ui) {
         this.game = game;
@@ -5,9 +98,83 @@ class COMInterface {
         this.port = null;
         this.connected = false;
         this.reader = null;
-        this.receiveBuffer = '';
+        // Принятые байты; разбираются построчно (ASCII) или по кадрам (binary)
+        this.rxBytes = new Uint8Array(4096);
+        this.rxLength = 0;
         this.bufferTimeout = null;
         this.BUFFER_TIMEOUT_MS = 50;
+        this.textDecoder = new TextDecoder();
+        this.textEncoder = new TextEncoder();
+        // Протокол: 'sync' — ждём подтверждения после подключения, 'ascii' или 'binary'
+        this.protocol = 'ascii';
+        this.preferredProtocol = 'binary'; // 'ascii' — для отладки
+        this.syncTimeout = null;
+        this.SYNC_TIMEOUT_MS = 1000;
+        this.syncMarker = this.textEncoder.encode('PROTO:ASCII');
+        // Буфер декодированного кадра, читается через DataView без создания строк
+        this.frameBuf = new Uint8Array(256);
+        this.frameView = new DataView(this.frameBuf.buffer);
+        this.crcErrors = 0;
+        // Агрегированный кадр тика (TICK) — один объект на всё время работы
+        this.aggregateTelemetry = true;
+        this.tickFrame = {
+            time: 0,
+            stormX: 0,
+            stormY: 0,
+            count: 0,
+            events: Array.from({ length: 8 }, () => ({ msg: 0, type: 0, x: 0, y: 0 }))
+        };
+        // Параметрический шторм: волна считается в браузере по тику платы
+        this.parametricStorm = true;
+        this.deviceClockSamples = [];
+        this.DEVICE_CLOCK_SAMPLES = 4;
+        this.deviceClockOffset = 0;
+        this.stormDriftMs = 0;
+        this.deviceNow = this.deviceNow.bind(this);
+        // Записи в порт выполняются строго по очереди
+        this.writeChain = Promise.resolve();
+        this.readLoop = null;
+        // Скорость порта: после синхронизации просим плату перейти на preferredBaudRate,
+        // при неудачной проверке обе стороны возвращаются к DEFAULT_BAUD_RATE
+        this.DEFAULT_BAUD_RATE = 115200;
+        this.preferredBaudRate = 921600;
+        this.baudRate = this.DEFAULT_BAUD_RATE;
+        this.baudSwitching = false;
+        this.baudConfirm = null;
+        this.BAUD_PROBE_ATTEMPTS = 3;
+        this.BAUD_PROBE_TIMEOUT_MS = 300;
+        // Надёжный канал (CMD:REL): игровые команды и события идут с номерами,
+        // подтверждаются накопительными ACK и переотправляются по таймауту
+        this.reliableChannel = true;
+        this.relActive = false;
+        this.relTxSeq = 0;
+        this.relTxWindow = [];
+        this.relTxBacklog = [];
+        this.relRxNext = 0;
+        this.relAckPending = false;
+        this.relTimer = null;
+        this.REL_WINDOW = 16;
+        this.REL_RTO_MS = 250;
+        // Строка платы — CMD_LINE_SIZE в COM-device/Core/Inc/comm.h вместе с '\0'
+        this.CMD_LINE_SIZE = 40;
+        this.RELIABLE_COMMANDS = new Set(['START', 'PAUSE', 'RESET', 'SHOT', 'STORM_UPDATE']);
+        // Метки времени событий (CMD:TS) и часы платы по PING/PONG:
+        // смещение берётся из замера с наименьшим RTT среди последних CLOCK_SAMPLES
+        this.eventTimestamps = true;
+        this.timestampsActive = false;
+        this.clockSamples = [];
+        this.CLOCK_SAMPLES = 8;
+        this.clockSynced = false;
+        this.clockRtt = 0;
+        this.pingTimer = null;
+        this.PING_INTERVAL_MS = 1000;
+        this.lastEventTick = null;
+        this.latencyStats = {};
+        // Запись и воспроизведение сеанса (session-recorder.js). Всё время в
+        // классе берётся из clock — при воспроизведении это часы записи
+        this.recorder = null;
+        this.replayer = null;
+        this.clock = performance;
         this.handleData = this.handleData.bind(this);
 
         this.handleLeftStep = this.handleLeftStep.bind(this);
@@ -20,6 +187,7 @@ class COMInterface {
 
     init() {
         this.setupConnectButton();
+        this.setupTraceControls();
         this.checkPermissions();
     }
 
@@ -36,6 +204,25 @@ class COMInterface {
         }
     }
 
+    setupTraceControls() {
+        document.getElementById('com-record-btn')?.addEventListener('click', () => {
+            if (this.recorder) this.stopRecording();
+            else this.startRecording();
+        });
+        const replayBtn = document.getElementById('com-replay-btn');
+        const replayFile = document.getElementById('com-replay-file');
+        const replaySpeed = document.getElementById('com-replay-speed');
+        replayBtn?.addEventListener('click', () => {
+            if (this.replayer) this.stopReplay();
+            else replayFile?.click();
+        });
+        replayFile?.addEventListener('change', () => {
+            const file = replayFile.files[0];
+            replayFile.value = '';
+            if (file) this.replayTrace(file, Number(replaySpeed?.value ?? 1));
+        });
+    }
+
     async checkPermissions() {
         if (!('serial' in navigator)) {
             console.warn('Web Serial API не поддерживается');
@@ -50,6 +237,10 @@ class COMInterface {
     }
 
     async connectWithRetry() {
+        if (this.replayer) {
+            this.game.logMessage('Идёт воспроизведение записи — подключение недоступно');
+            return;
+        }
         try {
             this.game.logMessage('Выберите COM-порт в появившемся окне...');
             const port = await this.requestPortWithTimeout(10000);
@@ -85,12 +276,14 @@ class COMInterface {
 
     async connectToPort(port) {
         try {
-            await port.open({ baudRate: 115200 });
+            await port.open({ baudRate: this.DEFAULT_BAUD_RATE });
             this.port = port;
+            this.baudRate = this.DEFAULT_BAUD_RATE;
             this.connected = true;
             this.updateUIStatus(true);
             this.game.logMessage('COM-порт подключён');
-            this.startReading();
+            this.readLoop = this.startReading();
+            this.negotiateProtocol();
         } catch (error) {
             console.error('Ошибка открытия порта:', error);
             throw error;
@@ -105,8 +298,8 @@ class COMInterface {
                 const { value, done } = await this.reader.read();
                 if (done) break;
                 if (value) {
-                    const text = new TextDecoder().decode(value);
-                    this.processIncomingData(text);
+                    this.recorder?.record(TRACE.RX, value);
+                    this.processIncomingData(value);
                 }
             }
         } catch (error) {
@@ -132,27 +325,482 @@ class COMInterface {
         }
     }
 
-    processIncomingData(text) {
-        this.receiveBuffer += text;
+    // Переоткрывает порт на другой скорости. Выполняется в очереди записей,
+    // поэтому команды, отправленные во время переключения, уйдут уже после него.
+    reopenPort(baudRate) {
+        const reopen = this.writeChain.then(async () => {
+            if (!this.port) return;
+            if (this.reader) await this.reader.cancel().catch(() => {});
+            await this.readLoop;
+            await this.port.close();
+            await this.port.open({ baudRate });
+            this.baudRate = baudRate;
+            this.recorder?.recordBaud(baudRate);
+            this.rxLength = 0;
+            this.readLoop = this.startReading();
+        });
+        this.writeChain = reopen.catch(() => {});
+        return reopen;
+    }
+
+    async negotiateBaudRate(baudRate) {
+        if (!this.connected || this.baudSwitching || baudRate === this.baudRate) return false;
+        this.baudSwitching = true;
+        return this.sendCommand(`BAUD:${baudRate}`);
+    }
+
+    // Плата подтвердила смену скорости и ждёт CMD:BAUD_PROBE уже на новой
+    async onBaudAck(baudRate) {
+        try {
+            await this.reopenPort(baudRate);
+            for (let attempt = 0; attempt < this.BAUD_PROBE_ATTEMPTS; attempt++) {
+                const confirmed = this.waitBaudConfirm(this.BAUD_PROBE_TIMEOUT_MS);
+                await this.sendCommand('BAUD_PROBE');
+                if (await confirmed) {
+                    this.game.logMessage(`COM: скорость ${baudRate} бод`);
+                    return;
+                }
+            }
+            this.game.logMessage(`COM: ${baudRate} бод не поддерживается, возврат к ${this.DEFAULT_BAUD_RATE}`);
+            await this.reopenPort(this.DEFAULT_BAUD_RATE);
+        } catch (error) {
+            console.error('Ошибка смены скорости:', error);
+            if (this.connected) {
+                await this.safeDisconnect();
+                this.game.logMessage('COM-соединение разорвано: ' + error.message);
+            }
+        } finally {
+            this.baudConfirm = null;
+            this.baudSwitching = false;
+        }
+    }
+
+    waitBaudConfirm(timeout) {
+        return new Promise(resolve => {
+            const timer = setTimeout(() => {
+                this.baudConfirm = null;
+                resolve(false);
+            }, timeout);
+            this.baudConfirm = () => {
+                clearTimeout(timer);
+                this.baudConfirm = null;
+                resolve(true);
+            };
+        });
+    }
+
+    processIncomingData(bytes) {
+        this.appendReceived(bytes);
+        if (this.protocol === 'binary' || this.timestampsActive) {
+            // Кадры самодостаточны, а время события известно из метки —
+            // разбираем сразу, без ожидания паузы
+            this.processBuffer();
+            return;
+        }
         if (this.bufferTimeout) clearTimeout(this.bufferTimeout);
         this.bufferTimeout = setTimeout(() => this.processBuffer(), this.BUFFER_TIMEOUT_MS);
     }
 
+    // Разбирает принятое сразу, не дожидаясь паузы в приёме
+    flushReceived() {
+        if (!this.bufferTimeout) return;
+        clearTimeout(this.bufferTimeout);
+        this.bufferTimeout = null;
+        this.processBuffer();
+    }
+
+    appendReceived(bytes) {
+        const needed = this.rxLength + bytes.length;
+        if (needed > this.rxBytes.length) {
+            const grown = new Uint8Array(Math.max(this.rxBytes.length * 2, needed));
+            grown.set(this.rxBytes.subarray(0, this.rxLength));
+            this.rxBytes = grown;
+        }
+        this.rxBytes.set(bytes, this.rxLength);
+        this.rxLength = needed;
+    }
+
     processBuffer() {
-        if (!this.receiveBuffer) return;
-        const lines = this.receiveBuffer.split('\r\n');
-        this.receiveBuffer = lines.pop() || '';
-        lines.forEach(line => {
-            const trimmed = line.trim();
-            if (trimmed) {
-                this.game.logMessage(`COM: ${trimmed}`);
-                this.handleData(trimmed);
+        let pos = 0;
+        // Протокол может смениться посреди буфера (PROTO:BIN / PROTO:ASCII)
+        while (pos < this.rxLength) {
+            let next;
+            if (this.protocol === 'binary') next = this.processFrame(pos);
+            else if (this.protocol === 'sync') next = this.processSync(pos);
+            else next = this.processLine(pos);
+            if (next < 0) break; // неполная строка или кадр
+            pos = next;
+        }
+        this.rxBytes.copyWithin(0, pos, this.rxLength);
+        this.rxLength -= pos;
+    }
+
+    indexOfByte(value, start) {
+        const index = this.rxBytes.indexOf(value, start);
+        return (index >= 0 && index < this.rxLength) ? index : -1;
+    }
+
+    processLine(start) {
+        const newline = this.indexOfByte(0x0A, start);
+        if (newline < 0) return -1;
+        const trimmed = this.textDecoder.decode(this.rxBytes.subarray(start, newline)).trim();
+        if (trimmed) {
+            this.game.logMessage(`COM: ${trimmed}`);
+            this.handleData(trimmed);
+        }
+        return newline + 1;
+    }
+
+    processFrame(start) {
+        const end = this.indexOfByte(0x00, start);
+        if (end < 0) return -1;
+        if (end > start) this.handleFrame(this.rxBytes, start, end);
+        return end + 1;
+    }
+
+    // После подключения плата может остаться в бинарном режиме с прошлого сеанса.
+    // Подтверждение PROTO:ASCII приходит строкой или TEXT-кадром — всё до него отбрасываем.
+    processSync(start) {
+        const buf = this.rxBytes;
+        const marker = this.syncMarker;
+        let at = this.indexOfByte(marker[0], start);
+        while (at >= 0) {
+            if (at + marker.length > this.rxLength) return -1;
+            let match = true;
+            for (let i = 1; i < marker.length && match; i++) {
+                match = buf[at + i] === marker[i];
             }
-        });
+            if (match) break;
+            at = this.indexOfByte(marker[0], at + 1);
+        }
+        if (at < 0) return -1;
+
+        const after = at + marker.length;
+        if (after + 2 > this.rxLength) return -1;
+        let next;
+        if (buf[after] === 0x0D && buf[after + 1] === 0x0A) {
+            next = after + 2;
+        } else {
+            const end = this.indexOfByte(0x00, after);
+            if (end < 0) return -1;
+            next = end + 1;
+        }
+        this.onProtocolAck('ascii');
+        return next;
+    }
+
+    handleFrame(buf, start, end) {
+        const len = cobsDecode(buf, start, end, this.frameBuf);
+        if (len < 3 || crc16(this.frameBuf, 0, len - 2) !== this.frameView.getUint16(len - 2, true)) {
+            this.crcErrors++;
+            return;
+        }
+        this.handleMessage(len);
+    }
+
+    // Сообщение лежит в начале frameBuf, len включает два байта CRC
+    handleMessage(len) {
+        const frame = this.frameBuf;
+        const view = this.frameView;
+        switch (frame[0]) {
+            case MSG.TIME:
+                this.noteFrameTick('TIME', 2, len);
+                this.game?.updateTimeFromCom(view.getUint8(1));
+                break;
+            case MSG.SHIP:
+                this.noteFrameTick('SHIP', 6, len);
+                this.game?.addShipFromCom(view.getUint8(1), view.getUint16(2, true), view.getUint16(4, true));
+                break;
+            case MSG.HIT:
+                this.noteFrameTick('RESULT', 6, len);
+                this.game?.handleComHit(view.getUint8(1), view.getUint16(2, true), view.getUint16(4, true));
+                break;
+            case MSG.MISS:
+                this.noteFrameTick('RESULT', 5, len);
+                this.game?.handleComMiss(view.getUint16(1, true), view.getUint16(3, true));
+                break;
+            case MSG.STORM:
+                this.noteFrameTick('STORM', 5, len);
+                this.game?.setStormOffset(view.getInt16(1, true), view.getInt16(3, true));
+                break;
+            case MSG.TICK: {
+                const tick = this.tickFrame;
+                tick.time = view.getUint8(1);
+                tick.stormX = view.getInt16(2, true);
+                tick.stormY = view.getInt16(4, true);
+                tick.count = Math.min(view.getUint8(6), tick.events.length);
+                for (let i = 0, at = 7; i < tick.count && at + 6 <= len - 2; i++, at += 6) {
+                    const ev = tick.events[i];
+                    ev.msg = view.getUint8(at);
+                    ev.type = view.getUint8(at + 1);
+                    ev.x = view.getUint16(at + 2, true);
+                    ev.y = view.getUint16(at + 4, true);
+                }
+                this.noteFrameTick('TICK', 7 + 6 * view.getUint8(6), len);
+                this.game?.applyTelemetryFrame(tick);
+                break;
+            }
+            case MSG.STORM_PARAM:
+                this.noteDeviceTick(view.getUint32(9, true));
+                this.applyStormParams(view.getUint8(1), view.getUint8(2), view.getUint16(3, true),
+                    view.getUint16(5, true), view.getUint16(7, true));
+                break;
+            case MSG.STORM_SYNC:
+                this.noteDeviceTick(view.getUint32(1, true));
+                break;
+            case MSG.REL:
+                if (this.relAccept(view.getUint16(1, true))) {
+                    frame.copyWithin(0, 3, len);
+                    this.handleMessage(len - 3);
+                }
+                break;
+            case MSG.ACK:
+                this.onRelAck(view.getUint16(1, true));
+                break;
+            case MSG.TEXT: {
+                // Редкие текстовые сообщения (ответы на команды) — обычным путём
+                const text = this.textDecoder.decode(frame.subarray(1, len - 2));
+                this.game.logMessage(`COM: ${text}`);
+                this.handleData(text);
+                break;
+            }
+        }
+    }
+
+    negotiateProtocol() {
+        this.protocol = 'sync';
+        if (this.syncTimeout) clearTimeout(this.syncTimeout);
+        // Старая прошивка не знает PROTO — остаёмся в текстовом режиме
+        this.syncTimeout = setTimeout(() => this.onProtocolAck('ascii'), this.SYNC_TIMEOUT_MS);
+        this.sendCommand('PROTO:ASCII');
+    }
+
+    onProtocolAck(mode) {
+        const wasSync = this.protocol === 'sync';
+        if (this.syncTimeout) {
+            clearTimeout(this.syncTimeout);
+            this.syncTimeout = null;
+        }
+        this.protocol = mode;
+        this.game.logMessage(`COM: протокол ${mode === 'binary' ? 'бинарный' : 'текстовый'}`);
+        if (wasSync && this.preferredProtocol === 'binary') {
+            this.sendCommand('PROTO:BIN');
+        }
+        if (wasSync && this.aggregateTelemetry) {
+            this.sendCommand('AGG:1');
+        }
+        if (wasSync && this.parametricStorm) {
+            this.sendCommand('STORM_MODE:PARAM');
+        }
+        if (wasSync && this.eventTimestamps) {
+            this.sendCommand('TS:1');
+        }
+        if (wasSync && this.reliableChannel) {
+            this.sendCommand('REL:1');
+        }
+        if (wasSync && this.preferredBaudRate !== this.baudRate) {
+            this.negotiateBaudRate(this.preferredBaudRate);
+        }
+    }
+
+    // Оценка тика платы: tick - clock.now() без учёта задержки доставки.
+    // Задержка только уменьшает оценку, поэтому берём максимум по последним отметкам.
+    noteDeviceTick(tick) {
+        const now = this.clock.now();
+        if (this.deviceClockSamples.length || this.clockSynced) {
+            this.stormDriftMs = this.deviceNow() - tick;
+        }
+        if (this.clockSynced) return; // PING/PONG точнее
+        this.deviceClockSamples.push(tick - now);
+        if (this.deviceClockSamples.length > this.DEVICE_CLOCK_SAMPLES) {
+            this.deviceClockSamples.shift();
+        }
+        this.deviceClockOffset = Math.max(...this.deviceClockSamples);
+    }
+
+    setTimestamps(active) {
+        this.timestampsActive = active;
+        this.clockSamples = [];
+        this.clockSynced = false;
+        this.latencyStats = {};
+        if (this.pingTimer) clearInterval(this.pingTimer);
+        this.pingTimer = null;
+        if (active) {
+            this.sendPing();
+            this.pingTimer = setInterval(() => this.sendPing(), this.PING_INTERVAL_MS);
+        }
+    }
+
+    sendPing() {
+        this.sendCommand(`PING:${Math.round(this.clock.now())}`, false);
+    }
+
+    // Плата ответила тиком на момент обработки; считаем его серединой круга
+    onPong(sentAt, tick) {
+        const rtt = this.clock.now() - sentAt;
+        if (isNaN(rtt) || isNaN(tick) || rtt < 0) return;
+        this.clockSamples.push({ rtt, offset: tick - (sentAt + rtt / 2) });
+        if (this.clockSamples.length > this.CLOCK_SAMPLES) {
+            this.clockSamples.shift();
+        }
+        const best = this.clockSamples.reduce((a, b) => (b.rtt < a.rtt ? b : a));
+        this.deviceClockOffset = best.offset;
+        this.clockRtt = best.rtt;
+        this.clockSynced = true;
+    }
+
+    // Задержка доставки по типам сообщений: от тика события до разбора в браузере
+    noteEventTick(type, tick) {
+        this.lastEventTick = tick;
+        if (!this.clockSynced) return;
+        const latency = this.deviceNow() - tick;
+        const stats = this.latencyStats[type] || (this.latencyStats[type] = { count: 0, mean: 0, max: 0 });
+        stats.count++;
+        stats.mean += (latency - stats.mean) / Math.min(stats.count, 64);
+        stats.max = Math.max(stats.max, latency);
+    }
+
+    noteFrameTick(type, base, len) {
+        if (len - 2 >= base + 4) this.noteEventTick(type, this.frameView.getUint32(base, true));
+    }
+
+    deviceNow() {
+        return this.clock.now() + this.deviceClockOffset;
+    }
+
+    applyStormParams(ampX, ampY, periodX, periodY, phaseYMrad) {
+        this.game.stormAmplitudeX = ampX;
+        this.game.stormAmplitudeY = ampY;
+        this.game?.setStormModel({
+            ampX,
+            ampY,
+            periodX,
+            periodY,
+            phaseY: phaseYMrad / 1000
+        }, this.deviceNow);
+    }
+
+    // TICK:<время>,<шторм x>,<шторм y>[;S:тип,x,y][;H:тип,x,y][;M:x,y]
+    parseTickLine(data) {
+        const tick = this.tickFrame;
+        const parts = data.substring(5).split(';');
+        const [time, stormX, stormY] = parts[0].split(',').map(Number);
+        if (isNaN(time) || isNaN(stormX) || isNaN(stormY)) return null;
+        tick.time = time;
+        tick.stormX = stormX;
+        tick.stormY = stormY;
+        tick.count = 0;
+        for (let i = 1; i < parts.length && tick.count < tick.events.length; i++) {
+            const kind = parts[i][0];
+            const nums = parts[i].substring(2).split(',').map(Number);
+            const ev = tick.events[tick.count];
+            if (kind === 'M') {
+                ev.msg = MSG.MISS;
+                ev.type = 0;
+                [ev.x, ev.y] = nums;
+            } else {
+                ev.msg = kind === 'S' ? MSG.SHIP : MSG.HIT;
+                [ev.type, ev.x, ev.y] = nums;
+            }
+            if (![ev.type, ev.x, ev.y].some(isNaN)) tick.count++;
+        }
+        return tick;
+    }
+
+    // Переключение вручную, например из консоли: ui.comInterface.setProtocol('ascii')
+    setProtocol(mode) {
+        this.preferredProtocol = mode;
+        return this.sendCommand(mode === 'binary' ? 'PROTO:BIN' : 'PROTO:ASCII');
+    }
+
+    encodeBinaryCommand(command) {
+        const msg = new Uint8Array(12);
+        const view = new DataView(msg.buffer);
+        let at = 0;
+        // R:<seq>:<команда> — та же команда в обёртке CMD_REL
+        if (command.startsWith('R:')) {
+            const sep = command.indexOf(':', 2);
+            msg[0] = MSG.CMD_REL;
+            view.setUint16(1, parseInt(command.substring(2, sep)), true);
+            at = 3;
+            command = command.substring(sep + 1);
+        }
+        const sep = command.indexOf(':');
+        const name = sep < 0 ? command : command.substring(0, sep);
+        const args = sep < 0 ? [] : command.substring(sep + 1).split(',').map(Number);
+        let len = at + 1;
+        switch (name) {
+            case 'START': msg[at] = MSG.CMD_START; break;
+            case 'PAUSE': msg[at] = MSG.CMD_PAUSE; break;
+            case 'RESET': msg[at] = MSG.CMD_RESET; break;
+            case 'SHOT':
+                if (args.length < 2 || !args.every(Number.isInteger)) return null;
+                msg[at] = MSG.CMD_SHOT;
+                view.setUint16(at + 1, args[0], true);
+                view.setUint16(at + 3, args[1], true);
+                len = at + 5;
+                break;
+            case 'STORM_UPDATE':
+                if (args.length < 2 || !args.every(Number.isInteger)) return null;
+                msg[at] = MSG.CMD_STORM_UPDATE;
+                view.setInt8(at + 1, args[0]);
+                view.setInt8(at + 2, args[1]);
+                len = at + 3;
+                break;
+            case 'PROTO':
+                msg[at] = MSG.CMD_PROTO;
+                msg[at + 1] = command.endsWith('BIN') ? 1 : 0;
+                len = at + 2;
+                break;
+            case 'ACK':
+                if (!Number.isInteger(args[0])) return null;
+                msg[at] = MSG.CMD_ACK;
+                view.setUint16(at + 1, args[0], true);
+                len = at + 3;
+                break;
+            default:
+                return null; // остальное плата принимает текстом в любом режиме
+        }
+        view.setUint16(len, crc16(msg, 0, len), true);
+        return cobsEncode(msg, len + 2);
     }
 
     handleData(data) {
-        if (data.startsWith('TIME:')) {
+        const stamp = this.timestampsActive ? TIMESTAMP_SUFFIX.exec(data) : null;
+        if (stamp) {
+            data = data.substring(0, stamp.index);
+            const name = EVENT_NAME.exec(data);
+            this.noteEventTick(name ? name[1] : '?', parseInt(stamp[1]));
+        }
+
+        if (data.startsWith('R:')) {
+            // R:<seq>:<сообщение> — событие надёжного канала
+            const sep = data.indexOf(':', 2);
+            if (sep > 2 && this.relAccept(parseInt(data.substring(2, sep)))) {
+                this.handleData(data.substring(sep + 1));
+            }
+        }
+        else if (data.startsWith('ACK:')) {
+            this.onRelAck(parseInt(data.substring(4)));
+        }
+        else if (data.startsWith('PONG:')) {
+            const parts = data.substring(5).split(',');
+            this.onPong(parseInt(parts[0]), parseInt(parts[1]));
+        }
+        else if (data.startsWith('TS:')) {
+            this.setTimestamps(data.substring(3) === '1');
+        }
+        else if (data.startsWith('REL:')) {
+            this.setReliable(data.substring(4) === '1');
+        }
+        else if (data.startsWith('BAUD:')) {
+            this.handleBaudReply(data.substring(5));
+        }
+        else if (data.startsWith('TICK:')) {
+            const tick = this.parseTickLine(data);
+            if (tick) this.game?.applyTelemetryFrame(tick);
+        }
+        else if (data.startsWith('TIME:')) {
             const seconds = parseInt(data.substring(5));
             if (!isNaN(seconds) && this.game) {
                 this.game.updateTimeFromCom(seconds);
@@ -208,6 +856,22 @@ class COMInterface {
                 this.game?.setStormOffset(x, y);
             }
         }
+        else if (data.startsWith('STORM_PARAM:')) {
+            const [ampX, ampY, periodX, periodY, phase, tick] = data.substring(12).split(',').map(Number);
+            if (![ampX, ampY, periodX, periodY, phase, tick].some(isNaN) && periodX > 0 && periodY > 0) {
+                this.noteDeviceTick(tick);
+                this.applyStormParams(ampX, ampY, periodX, periodY, phase);
+            }
+        }
+        else if (data.startsWith('STORM_SYNC:')) {
+            const tick = Number(data.substring(11));
+            if (!isNaN(tick)) this.noteDeviceTick(tick);
+        }
+        else if (data === 'STORM_MODE:SAMPLE') {
+            this.game?.setStormModel(null);
+        }
+        else if (data === 'PROTO:BIN') this.onProtocolAck('binary');
+        else if (data === 'PROTO:ASCII') this.onProtocolAck('ascii');
         else if (data.startsWith('STORM_AMP_UPDATED:')) {
             const [xStr, yStr] = data.substring(19).split(',');
             const x = parseInt(xStr);
@@ -297,10 +961,104 @@ class COMInterface {
         }
     }
 
+    handleBaudReply(reply) {
+        const rate = parseInt(reply.substring(reply.indexOf(':') + 1));
+        if (reply.startsWith('ACK:')) {
+            if (!isNaN(rate)) this.onBaudAck(rate);
+        } else if (reply.startsWith('OK:')) {
+            if (this.baudConfirm && rate === this.baudRate) this.baudConfirm();
+        } else if (reply.startsWith('ERR:')) {
+            this.baudSwitching = false;
+            this.game.logMessage(`COM: плата отклонила скорость ${rate}`);
+        } else if (reply.startsWith('FALLBACK:')) {
+            // Плата не дождалась проверки — догоняем её на стандартной скорости
+            if (!isNaN(rate) && rate !== this.baudRate) this.reopenPort(rate);
+        }
+    }
+
+    setReliable(active) {
+        this.relActive = active;
+        this.relTxSeq = 0;
+        this.relTxWindow = [];
+        this.relTxBacklog = [];
+        this.relRxNext = 0;
+        if (this.relTimer) clearInterval(this.relTimer);
+        this.relTimer = active ? setInterval(() => this.relRetransmit(), this.REL_RTO_MS / 2) : null;
+    }
+
+    // Событие принимается только по порядку; повтор и всё после пропуска
+    // отбрасываются — плата перешлёт их сама. ACK один на пачку сообщений.
+    relAccept(seq) {
+        if (!this.relAckPending) {
+            this.relAckPending = true;
+            queueMicrotask(() => {
+                this.relAckPending = false;
+                this.sendCommand(`ACK:${(this.relRxNext - 1) & 0xFFFF}`, false);
+            });
+        }
+        if (seq !== this.relRxNext) return false;
+        this.relRxNext = (this.relRxNext + 1) & 0xFFFF;
+        return true;
+    }
+
+    onRelAck(seq) {
+        if (isNaN(seq)) return;
+        // Накопительный ACK: снимаем всё до seq включительно (с учётом переполнения)
+        while (this.relTxWindow.length && ((seq - this.relTxWindow[0].seq) & 0xFFFF) < 0x8000) {
+            this.relTxWindow.shift();
+        }
+        while (this.relTxBacklog.length && this.relTxWindow.length < this.REL_WINDOW) {
+            this.sendReliable(this.relTxBacklog.shift());
+        }
+    }
+
+    sendReliable(command) {
+        // Не влезающую в строку платы команду она отбросит, а мы бы повторяли её вечно;
+        // длину считаем по самому длинному номеру, чтобы повтор не мог её превысить
+        if (`CMD:R:65535:${command}`.length >= this.CMD_LINE_SIZE) {
+            console.warn(`Команда слишком длинная для надёжного канала: CMD:${command}`);
+            return Promise.resolve(false);
+        }
+        if (this.relTxWindow.length >= this.REL_WINDOW) {
+            this.relTxBacklog.push(command);
+            return Promise.resolve(true);
+        }
+        const entry = { seq: this.relTxSeq, command, sentAt: this.clock.now() };
+        this.relTxSeq = (this.relTxSeq + 1) & 0xFFFF;
+        this.relTxWindow.push(entry);
+        this.game.logMessage(`→ Отправлено на COM: CMD:${command} [#${entry.seq}]`);
+        return this.sendCommand(`R:${entry.seq}:${command}`, false);
+    }
+
+    relRetransmit() {
+        const oldest = this.relTxWindow[0];
+        const now = this.clock.now();
+        if (!oldest || now - oldest.sentAt < this.REL_RTO_MS) return;
+        // Плата выполняет команды строго по порядку — повторяем всё окно
+        for (const entry of this.relTxWindow) {
+            entry.sentAt = now;
+            this.sendCommand(`R:${entry.seq}:${entry.command}`, false);
+        }
+    }
+
+    // Состояние обмена к началу сеанса: после отключения и вокруг воспроизведения
+    resetSession() {
+        if (this.bufferTimeout) clearTimeout(this.bufferTimeout);
+        this.bufferTimeout = null;
+        if (this.syncTimeout) clearTimeout(this.syncTimeout);
+        this.syncTimeout = null;
+        this.rxLength = 0;
+        this.protocol = 'ascii';
+        this.baudRate = this.DEFAULT_BAUD_RATE;
+        this.setReliable(false);
+        this.setTimestamps(false);
+        this.deviceClockSamples = [];
+        this.game?.setStormModel(null);
+    }
+
     async safeDisconnect() {
         this.connected = false;
-        if (this.bufferTimeout) clearTimeout(this.bufferTimeout);
-        this.receiveBuffer = '';
+        this.resetSession();
         await this.releaseReader();
         if (this.port) {
             await this.port.close();
@@ -314,19 +1072,144 @@ class COMInterface {
         this.game.logMessage('COM-порт отключён');
     }
 
+    // Запись сеанса, например из консоли: ui.comInterface.startRecording(),
+    // затем stopRecording() — файл .trace скачивается
+    startRecording() {
+        if (this.recorder || this.replayer) return false;
+        this.recorder = new SessionRecorder(this);
+        this.updateTraceStatus();
+        this.game.logMessage('COM: запись сеанса начата');
+        return true;
+    }
+
+    stopRecording() {
+        const recorder = this.recorder;
+        if (!recorder) return null;
+        this.recorder = null;
+        this.updateTraceStatus();
+        const blob = recorder.finish();
+        const stamp = new Date(recorder.startedAt).toISOString().replace(/[:.]/g, '-');
+        const link = document.createElement('a');
+        link.href = URL.createObjectURL(blob);
+        link.download = `session-${stamp}.trace`;
+        link.click();
+        setTimeout(() => URL.revokeObjectURL(link.href), 0);
+        this.game.logMessage(`COM: запись сеанса сохранена — ${recorder.records} записей, ${blob.size} байт` +
+            (recorder.overflow ? ' (конец не поместился)' : ''));
+        return blob;
+    }
+
+    // Воспроизведение записи без порта: приём идёт в processIncomingData(),
+    // отправленные команды повторяются как действия пользователя.
+    // speed — во сколько раз быстрее реального времени, 0 — без пауз.
+    // Из консоли: ui.comInterface.replayTrace(file, 8)
+    async replayTrace(source, speed = 1) {
+        if (this.connected || this.replayer) {
+            this.game.logMessage('Воспроизведение недоступно: отключите COM и дождитесь конца текущего');
+            return null;
+        }
+        let trace;
+        try {
+            trace = parseTrace(source instanceof Blob ? await source.arrayBuffer() : source);
+        } catch (error) {
+            this.game.logMessage(`Ошибка воспроизведения: ${error.message}`);
+            return null;
+        }
+        const replayer = new SessionReplayer(this, trace, speed);
+        this.replayer = replayer;
+        this.clock = replayer;
+        this.resetSession();
+        this.protocol = trace.protocol;
+        this.baudRate = trace.baudRate;
+        if (trace.reliable) {
+            // Запись могла начаться посреди сеанса
+            this.setReliable(true);
+            this.relRxNext = trace.relRxNext;
+        }
+        if (trace.timestamps) this.setTimestamps(true);
+        this.ui.setControlMode('com');
+        this.updateTraceStatus();
+        this.game.logMessage(`COM: воспроизведение ${trace.records.length} записей, ` +
+            `${(trace.durationUs / 1e6).toFixed(1)} с, ${speed > 0 ? `${speed}×` : 'без пауз'}`);
+        try {
+            const stats = await replayer.run();
+            const traceMs = replayer.positionUs / 1000;
+            this.game.logMessage(`COM: воспроизведено ${stats.records} записей, ${stats.rxBytes} байт ` +
+                `за ${stats.wallMs.toFixed(0)} мс (${(traceMs / Math.max(stats.wallMs, 1)).toFixed(1)}×), ` +
+                `разбор ${stats.parseMs.toFixed(1)} мс, команд ${stats.commands}, ошибок CRC ${stats.crcErrors}`);
+            console.log('Воспроизведение записи:', stats);
+            return stats;
+        } finally {
+            this.resetSession();
+            this.clock = performance;
+            this.replayer = null;
+            this.updateTraceStatus();
+        }
+    }
+
+    stopReplay() {
+        this.replayer?.stop();
+    }
+
+    // Команда из записи: повторяем действие пользователя, которое её отправило
+    replayCommand(name) {
+        const game = this.game;
+        if (name === 'RESET') {
+            this.ui.handleResetClick();
+        } else if (name === 'START' && (!game.gameActive || game.gamePaused)) {
+            this.ui.handleStartClick();
+        } else if (name === 'PAUSE' && game.gameActive && !game.gamePaused) {
+            this.ui.handleStartClick();
+        }
+    }
+
+    updateTraceStatus() {
+        const recordBtn = document.getElementById('com-record-btn');
+        if (recordBtn) {
+            recordBtn.classList.toggle('active', !!this.recorder);
+            recordBtn.innerHTML = this.recorder
+                ? '<i class="fas fa-stop"></i><span>Сохранить запись</span>'
+                : '<i class="fas fa-circle"></i><span>Запись</span>';
+        }
+        const replayBtn = document.getElementById('com-replay-btn');
+        if (replayBtn) {
+            replayBtn.classList.toggle('active', !!this.replayer);
+            replayBtn.innerHTML = this.replayer
+                ? '<i class="fas fa-stop"></i><span>Остановить</span>'
+                : '<i class="fas fa-play"></i><span>Воспроизвести</span>';
+        }
+    }
+
+    async writeBytes(bytes) {
+        this.recorder?.record(TRACE.TX, bytes);
+        const writer = this.port.writable.getWriter();
+        try {
+            await writer.write(bytes);
+        } finally {
+            writer.releaseLock();
+        }
+    }
+
     //НОВЫЙ МЕТОД: отправка команд на STM32
-    async sendCommand(command) {
-        if (!this.connected || !this.port?.writable) {
+    async sendCommand(command, log = true) {
+        // Воспроизводимая запись уже содержит всё, что ушло на плату
+        if (this.replayer) return false;
+        if (!this.connected || !this.port) {
             console.warn('Невозможно отправить команду: COM не подключён');
             return false;
         }
+        if (this.relActive && this.RELIABLE_COMMANDS.has(command.split(':')[0])) {
+            return this.sendReliable(command);
+        }
         try {
-            const writer = this.port.writable.getWriter();
-            const encoder = new TextEncoder();
-            const message = `CMD:${command}\r\n`;
-            await writer.write(encoder.encode(message));
-            writer.releaseLock();
-            this.game.logMessage(`→ Отправлено на COM: ${message.trim()}`);
+            const frame = this.protocol === 'binary' ? this.encodeBinaryCommand(command) : null;
+            const message = `CMD:${command}`;
+            const payload = frame || this.textEncoder.encode(`${message}\r\n`);
+            // Поток нельзя заблокировать двумя writer'ами — выстраиваем записи в цепочку
+            const write = this.writeChain.then(() => this.writeBytes(payload));
+            this.writeChain = write.catch(() => {});
+            await write;
+            if (log) this.game.logMessage(`→ Отправлено на COM: ${message}${frame ? ' [bin]' : ''}`);
             return true;
         } catch (error) {
             console.error('Ошибка отправки команды:', error);
@@ -62,6 +62,16 @@ class ShipGame {
         this.stormGraphCanvas = document.getElementById('storm-graph');
         this.stormGraphCtx = this.stormGraphCanvas ? this.stormGraphCanvas.getContext('2d') : null;
         this.stormActive = false;
+        // Отложенная перерисовка интерфейса при применении кадра телеметрии
+        this.deferUIUpdate = false;
+        this.uiUpdatePending = false;
+        // Параметрический шторм (см. setStormModel)
+        this.stormModel = null;
+        this.stormDeviceNow = null;
+        this.stormModelFrame = null;
+        this.stormLastRecord = 0;
+        this.STORM_RECORD_INTERVAL_MS = 100;
+        this.updateStormModel = this.updateStormModel.bind(this);
 
         // Таймеры
         this.gameTimer = null;
@@ -597,18 +607,46 @@ class ShipGame {
         this.logMessage('Шторм прекратился.');
     }
 
-    setStormOffset(x, y) {
+    setStormOffset(x, y, record = true) {
         //if (!this.stormActive) return; // ← ключевая строка!
         this.stormOffsetX = x || 0;
         this.stormOffsetY = y || 0;
+        this.updateCrosshairVisualPosition();
+        if (!record) return;
         if (this.stormHistory) {
             this.stormHistory[this.stormHistoryIndex] = this.stormOffsetX;
             this.stormHistoryIndex = (this.stormHistoryIndex + 1) % this.stormHistory.length;
         }
-        this.updateCrosshairVisualPosition();
         this.redrawStormGraph();
     }
 
+    // Параметрический шторм: плата присылает амплитуды, периоды и фазу, а волна
+    // считается здесь на каждом кадре по оценке тика платы deviceNow()
+    setStormModel(model, deviceNow = null) {
+        this.stormModel = model;
+        this.stormDeviceNow = deviceNow;
+        if (model && !this.stormModelFrame) {
+            this.stormModelFrame = requestAnimationFrame(this.updateStormModel);
+        }
+    }
+
+    updateStormModel() {
+        this.stormModelFrame = null;
+        const model = this.stormModel;
+        if (!model) return;
+        if (this.gameActive && !this.gamePaused) {
+            const t = this.stormDeviceNow();
+            const x = model.ampX * Math.sin(2 * Math.PI * (t % model.periodX) / model.periodX);
+            const y = model.ampY * Math.sin(2 * Math.PI * (t % model.periodY) / model.periodY + model.phaseY);
+            // График истории по-прежнему пишется с шагом 100 мс
+            const now = performance.now();
+            const record = now - this.stormLastRecord >= this.STORM_RECORD_INTERVAL_MS;
+            if (record) this.stormLastRecord = now;
+            this.setStormOffset(x, y, record);
+        }
+        this.stormModelFrame = requestAnimationFrame(this.updateStormModel);
+    }
+
     redrawStormGraph() {
         if (!this.stormGraphCtx || !this.stormGraphCanvas) return;
 
@@ -873,7 +911,37 @@ class ShipGame {
         }, 600);
     }
     
+    // Агрегированный кадр тика от платы: события, время и шторм применяются
+    // одним проходом, а интерфейс перерисовывается один раз в конце
+    applyTelemetryFrame(frame) {
+        this.deferUIUpdate = true;
+        try {
+            for (let i = 0; i < frame.count; i++) {
+                const ev = frame.events[i];
+                if (ev.msg === MSG.SHIP) this.addShipFromCom(ev.type, ev.x, ev.y);
+                else if (ev.msg === MSG.HIT) this.handleComHit(ev.type, ev.x, ev.y);
+                else if (ev.msg === MSG.MISS) this.handleComMiss(ev.x, ev.y);
+            }
+            if (frame.time !== this.timeLeft) {
+                this.updateTimeFromCom(frame.time);
+            }
+        } finally {
+            this.deferUIUpdate = false;
+        }
+        if (this.uiUpdatePending) {
+            this.uiUpdatePending = false;
+            this.updateUI();
+        }
+        if (!this.stormModel && (frame.stormX !== this.stormOffsetX || frame.stormY !== this.stormOffsetY)) {
+            this.setStormOffset(frame.stormX, frame.stormY);
+        }
+    }
+
     updateUI() {
+        if (this.deferUIUpdate) {
+            this.uiUpdatePending = true;
+            return;
+        }
         this.scoreElement.textContent = this.score;
         this.hitsElement.textContent = this.hits;
         this.shotsElement.textContent = this.shots;
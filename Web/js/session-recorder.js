@@ -0,0 +1,241 @@
+// Запись сеанса COM: всё, что проходит через COMInterface в обе стороны,
+// с метками времени в микросекундах. Файл .trace (little-endian):
+//   заголовок — 'TGTR', версия, протокол на начало записи (0 — ascii,
+//   1 — binary, 2 — sync), флаги (бит 0 — REL, бит 1 — TS), резерв,
+//   скорость порта (u32), следующий ожидаемый номер надёжного канала (u16),
+//   резерв (u16), время начала (f64, мс от эпохи) и показание
+//   performance.now() в тот же момент (f64, мс);
+//   записи — тип (u8), пауза после предыдущей записи в мкс (varint),
+//   длина (varint), данные.
+// RX — байты от платы в том виде, в каком их отдал ридер, TX — одна запись
+// в порт, BAUD — новая скорость порта (u32).
+const TRACE = Object.freeze({
+    MAGIC: 0x52544754, // 'TGTR'
+    VERSION: 1,
+    HEADER_SIZE: 32,
+    RX: 0,
+    TX: 1,
+    BAUD: 2
+});
+
+const TRACE_PROTOCOLS = ['ascii', 'binary', 'sync'];
+const TRACE_MAX_BYTES = 64 * 1024 * 1024;
+// При максимальной скорости отдаём управление браузеру не реже, чем раз в REPLAY_SLICE_MS
+const REPLAY_SLICE_MS = 16;
+
+const TRACE_COMMANDS = Object.freeze({
+    [MSG.CMD_START]: 'START',
+    [MSG.CMD_PAUSE]: 'PAUSE',
+    [MSG.CMD_RESET]: 'RESET',
+    [MSG.CMD_SHOT]: 'SHOT',
+    [MSG.CMD_STORM_UPDATE]: 'STORM_UPDATE',
+    [MSG.CMD_PROTO]: 'PROTO',
+    [MSG.CMD_ACK]: 'ACK'
+});
+const TRACE_TEXT_COMMAND = /^CMD:(?:R:\d+:)?([A-Z_]+)/;
+
+// Имя команды из записи TX: текстовая строка CMD:... или бинарный кадр
+function traceCommandName(bytes) {
+    if (bytes.length && bytes[bytes.length - 1] === 0) {
+        const frame = new Uint8Array(bytes.length);
+        const len = cobsDecode(bytes, bytes[0] === 0 ? 1 : 0, bytes.length - 1, frame);
+        if (len < 3 || crc16(frame, 0, len - 2) !== (frame[len - 2] | (frame[len - 1] << 8))) return null;
+        const at = (frame[0] === MSG.CMD_REL) ? 3 : 0;
+        return at < len - 2 ? (TRACE_COMMANDS[frame[at]] || null) : null;
+    }
+    const match = TRACE_TEXT_COMMAND.exec(new TextDecoder().decode(bytes));
+    return match ? match[1] : null;
+}
+
+class SessionRecorder {
+    constructor(com) {
+        this.bytes = new Uint8Array(65536);
+        this.view = new DataView(this.bytes.buffer);
+        this.records = 0;
+        this.overflow = false;
+        this.startedAt = Date.now();
+        const clock = performance.now();
+        this.lastUs = Math.round(clock * 1000);
+
+        const view = this.view;
+        view.setUint32(0, TRACE.MAGIC, true);
+        view.setUint8(4, TRACE.VERSION);
+        view.setUint8(5, Math.max(0, TRACE_PROTOCOLS.indexOf(com.protocol)));
+        view.setUint8(6, (com.relActive ? 1 : 0) | (com.timestampsActive ? 2 : 0));
+        view.setUint32(8, com.baudRate, true);
+        view.setUint16(12, com.relRxNext, true);
+        view.setFloat64(16, this.startedAt, true);
+        view.setFloat64(24, clock, true);
+        this.length = TRACE.HEADER_SIZE;
+    }
+
+    reserve(needed) {
+        if (needed <= this.bytes.length) return;
+        const grown = new Uint8Array(Math.max(this.bytes.length * 2, needed));
+        grown.set(this.bytes.subarray(0, this.length));
+        this.bytes = grown;
+        this.view = new DataView(grown.buffer);
+    }
+
+    // Паузы длиннее 2^31 мкс тоже бывают — без побитовых операций
+    writeVarint(value) {
+        while (value >= 0x80) {
+            this.bytes[this.length++] = (value % 0x80) | 0x80;
+            value = Math.floor(value / 0x80);
+        }
+        this.bytes[this.length++] = value;
+    }
+
+    record(kind, data) {
+        if (this.overflow) return;
+        // тип + пауза (до 8 байт) + длина (до 5 байт)
+        const needed = this.length + 14 + data.length;
+        if (needed > TRACE_MAX_BYTES) {
+            this.overflow = true;
+            return;
+        }
+        this.reserve(needed);
+        const now = Math.round(performance.now() * 1000);
+        this.bytes[this.length++] = kind;
+        this.writeVarint(Math.max(0, now - this.lastUs));
+        this.writeVarint(data.length);
+        this.bytes.set(data, this.length);
+        this.length += data.length;
+        this.lastUs = Math.max(now, this.lastUs);
+        this.records++;
+    }
+
+    recordBaud(baudRate) {
+        const data = new Uint8Array(4);
+        new DataView(data.buffer).setUint32(0, baudRate, true);
+        this.record(TRACE.BAUD, data);
+    }
+
+    finish() {
+        return new Blob([this.bytes.slice(0, this.length)], { type: 'application/octet-stream' });
+    }
+}
+
+// Разбирает файл записи; времена записей — в мкс от начала
+function parseTrace(buffer) {
+    const bytes = new Uint8Array(buffer);
+    const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+    if (bytes.length < TRACE.HEADER_SIZE || view.getUint32(0, true) !== TRACE.MAGIC) {
+        throw new Error('это не файл записи сеанса');
+    }
+    if (view.getUint8(4) !== TRACE.VERSION) {
+        throw new Error(`неизвестная версия записи ${view.getUint8(4)}`);
+    }
+    const flags = view.getUint8(6);
+    const trace = {
+        protocol: TRACE_PROTOCOLS[view.getUint8(5)] || 'ascii',
+        reliable: (flags & 1) !== 0,
+        timestamps: (flags & 2) !== 0,
+        baudRate: view.getUint32(8, true),
+        relRxNext: view.getUint16(12, true),
+        startedAt: view.getFloat64(16, true),
+        clockStart: view.getFloat64(24, true),
+        records: [],
+        durationUs: 0
+    };
+
+    let at = TRACE.HEADER_SIZE;
+    const readVarint = () => {
+        let value = 0;
+        for (let scale = 1; at < bytes.length; scale *= 0x80) {
+            const b = bytes[at++];
+            value += (b & 0x7F) * scale;
+            if (b < 0x80) return value;
+        }
+        return -1;
+    };
+    let us = 0;
+    while (at < bytes.length) {
+        const kind = bytes[at++];
+        const delta = readVarint();
+        const len = readVarint();
+        // Оборванный хвост (например, вкладку закрыли при записи) отбрасываем
+        if (delta < 0 || len < 0 || at + len > bytes.length) break;
+        us += delta;
+        trace.records.push({ kind, us, data: bytes.subarray(at, at + len) });
+        at += len;
+    }
+    trace.durationUs = us;
+    return trace;
+}
+
+// Подаёт записанный приём в processIncomingData() без порта. Пока идёт
+// воспроизведение, COMInterface берёт время у replayer (clock.now()):
+// часы идут от начала записи в speed раз быстрее, при speed = 0 —
+// скачут от записи к записи.
+class SessionReplayer {
+    constructor(com, trace, speed) {
+        this.com = com;
+        this.trace = trace;
+        this.speed = speed > 0 ? speed : 0;
+        this.startedAt = performance.now();
+        this.positionUs = 0;
+        this.stopped = false;
+        this.stats = { records: 0, rxBytes: 0, commands: 0, parseMs: 0, wallMs: 0, crcErrors: 0 };
+    }
+
+    now() {
+        if (this.speed > 0) {
+            return this.trace.clockStart + (performance.now() - this.startedAt) * this.speed;
+        }
+        return this.trace.clockStart + this.positionUs / 1000;
+    }
+
+    stop() {
+        this.stopped = true;
+    }
+
+    async run() {
+        const com = this.com;
+        const crcErrors = com.crcErrors;
+        const delay = ms => new Promise(resolve => setTimeout(resolve, ms));
+        this.startedAt = performance.now();
+        let sliceStart = this.startedAt;
+
+        for (const rec of this.trace.records) {
+            if (this.stopped) break;
+            if (this.speed > 0) {
+                const wait = this.startedAt + rec.us / 1000 / this.speed - performance.now();
+                if (wait >= 1) await delay(wait);
+            } else if (performance.now() - sliceStart > REPLAY_SLICE_MS) {
+                await delay(0);
+                sliceStart = performance.now();
+            }
+            if (this.stopped) break;
+            this.positionUs = rec.us;
+            this.deliver(rec);
+            this.stats.records++;
+        }
+        com.flushReceived();
+        this.stats.wallMs = performance.now() - this.startedAt;
+        this.stats.crcErrors = com.crcErrors - crcErrors;
+        return this.stats;
+    }
+
+    deliver(rec) {
+        const com = this.com;
+        if (rec.kind === TRACE.RX) {
+            const start = performance.now();
+            com.processIncomingData(rec.data);
+            // Без пауз между записями текстовый разбор по таймауту не дождался бы тишины
+            if (this.speed === 0) com.flushReceived();
+            this.stats.parseMs += performance.now() - start;
+            this.stats.rxBytes += rec.data.length;
+        } else if (rec.kind === TRACE.TX) {
+            // Действие пользователя — после всего, что к тому моменту пришло
+            com.flushReceived();
+            const name = traceCommandName(rec.data);
+            if (name) {
+                com.replayCommand(name);
+                this.stats.commands++;
+            }
+        } else if (rec.kind === TRACE.BAUD && rec.data.length === 4) {
+            com.baudRate = new DataView(rec.data.buffer, rec.data.byteOffset, 4).getUint32(0, true);
+        }
+    }
+}
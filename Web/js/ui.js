@@ -101,7 +101,7 @@ class GameUI {
             }
             this.game.logMessage('Режим управления: Клавиатура. Таймер на веб-части.');
         } else if (mode === 'com') {
-            if (!this.comInterface || !this.comInterface.connected) {
+            if (!this.comInterface || !(this.comInterface.connected || this.comInterface.replayer)) {
                 this.game.logMessage('COM-устройство не подключено. Переключаюсь на клавиатуру.');
                 this.setControlMode('keyboard');
                 return;